@@ -0,0 +1,199 @@
+/***************************************************************************
+* 
+* File              : animations.h
+*
+* Author			: Kurt E. Clothier
+* Date				: October 17, 2026
+* Modified			: October 17, 2026
+*
+* Description       : Chase sequences as animation programs (see ANIM_END),
+*					: played by step_chase from flash
+*
+* Compiler			: AVR-GCC
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _ANIMATIONS_H_
+#define _ANIMATIONS_H_
+
+/***************************************************************************
+	Full Matrix
+****************************************************************************/
+// Loop through all colors
+static const uint8_t ANIM_LOOP_ALL[] PROGMEM = {
+	ANIM_RECT, ANIM_AT(ANIM_BOTH, 0, 0), ANIM_AT(0, 7, 7), ANIM_COLOR_REG,
+	ANIM_COLOR, ANIM_STEP_DOWN,
+	ANIM_WAIT, ANIM_TICKS(100),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+// Set matrix to white
+static const uint8_t ANIM_ALL_WHITE[] PROGMEM = {
+	ANIM_RECT, ANIM_AT(ANIM_M0, 0, 0), ANIM_AT(0, 7, 7), COL_WHITE,
+	ANIM_END
+};
+
+/***************************************************************************
+	Row & Column Sequences
+****************************************************************************/
+// Binary Counter - by Row
+static const uint8_t ANIM_BINARY_ROWS[] PROGMEM = {
+	ANIM_COUNT_ROWS, ANIM_AT(ANIM_M0, 0, 0), COL_RED,
+	ANIM_WAIT, ANIM_TICKS(250),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+// Binary Counter - by Columns
+static const uint8_t ANIM_BINARY_COLS[] PROGMEM = {
+	ANIM_COUNT_COLS, ANIM_AT(ANIM_M0, 0, 0), COL_BLUE,
+	ANIM_WAIT, ANIM_TICKS(250),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+/***************************************************************************
+	Quadrant Sequences
+****************************************************************************/
+// Color wheel - one color transistion per revolution
+static const uint8_t ANIM_QUAD_WHEEL[] PROGMEM = {
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 3), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 0), ANIM_COLOR_REG,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 0), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 1), ANIM_COLOR_REG,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 1), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 2), ANIM_COLOR_REG,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 2), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 3), ANIM_COLOR_REG,
+	ANIM_COLOR, ANIM_STEP_DOWN,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+// Color wheel - change colors with quadrants
+static const uint8_t ANIM_QUAD_WHEEL2[] PROGMEM = {
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 3), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 0), ANIM_COLOR_REG,
+	ANIM_COLOR, ANIM_STEP_DOWN,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 0), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 1), ANIM_COLOR_REG,
+	ANIM_COLOR, ANIM_STEP_DOWN,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 1), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 2), ANIM_COLOR_REG,
+	ANIM_COLOR, ANIM_STEP_DOWN,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 2), COL_BLACK,
+	ANIM_QUAD, ANIM_AT(ANIM_BOTH, 0, 3), ANIM_COLOR_REG,
+	ANIM_COLOR, ANIM_STEP_DOWN,
+	ANIM_WAIT, ANIM_TICKS(50),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+// Loop through all colors in Quadrant(s) set by quad_flags
+static const uint8_t ANIM_LOOP_QUAD[] PROGMEM = {
+	ANIM_QUADS, ANIM_COLOR_REG,
+	ANIM_COLOR, ANIM_STEP_DOWN,
+	ANIM_WAIT, ANIM_TICKS(100),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+/***************************************************************************
+	Miscellaneous
+****************************************************************************/
+#define FACE_COLOR	COL_OLIVE
+
+// Smiley Faces - look away, then back for a while
+static const uint8_t ANIM_SMILEY[] PROGMEM = {
+	ANIM_RECT, ANIM_AT(ANIM_BOTH, 0, 0), ANIM_AT(0, 7, 7), COL_BLACK,
+
+	// Border
+	ANIM_RECT, ANIM_AT(ANIM_BOTH, 0, 0), ANIM_AT(0, 0, 7), FACE_COLOR,
+	ANIM_RECT, ANIM_AT(ANIM_BOTH, 7, 0), ANIM_AT(0, 7, 7), FACE_COLOR,
+	ANIM_RECT, ANIM_AT(ANIM_BOTH, 0, 0), ANIM_AT(0, 7, 0), FACE_COLOR,
+	ANIM_RECT, ANIM_AT(ANIM_BOTH, 0, 7), ANIM_AT(0, 7, 7), FACE_COLOR,
+
+	// Eyes
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 1, 1), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 1, 2), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 1, 5), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 1, 6), COL_WHITE,
+
+	// Nose
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 3, 4), FACE_COLOR,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 3, 3), FACE_COLOR,
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 4, 3), FACE_COLOR,
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 4, 4), FACE_COLOR,
+
+	// Mouth
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 5, 1), COL_CORAL,
+	ANIM_RECT, ANIM_AT(ANIM_BOTH, 6, 2), ANIM_AT(0, 6, 5), COL_CORAL,
+	ANIM_PIXEL, ANIM_AT(ANIM_BOTH, 5, 6), COL_CORAL,
+
+	ANIM_MARK,
+
+	// Look away
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 2), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 1), COL_BLUE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 6), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 5), COL_BLUE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 1), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 2), COL_GREEN,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 5), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 6), COL_GREEN,
+	ANIM_WAIT, ANIM_TICKS(SMILEY_LOOK_TIME),
+
+	// Look back
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 1), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 2), COL_BLUE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 5), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 2, 6), COL_BLUE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 2), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 1), COL_GREEN,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 6), COL_WHITE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 2, 5), COL_GREEN,
+	ANIM_WAIT, ANIM_TICKS(SMILEY_EYE_DELAY),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+/***************************************************************************
+	Tests
+****************************************************************************/
+// Test corner LEDs
+static const uint8_t ANIM_TEST_CORNERS[] PROGMEM = {
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 7, 0), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 0, 0), COL_RED,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 4, 4), COL_RED,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 7, 7), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 0, 7), COL_RED,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 4, 3), COL_RED,
+	ANIM_WAIT, ANIM_TICKS(200),
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 0, 0), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 0, 7), COL_BLUE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 4, 4), COL_BLUE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 0, 7), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 0, 0), COL_BLUE,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 4, 3), COL_BLUE,
+	ANIM_WAIT, ANIM_TICKS(200),
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 0, 7), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 7, 7), COL_YELLOW,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 4, 4), COL_YELLOW,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 0, 0), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 7, 0), COL_YELLOW,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 4, 3), COL_YELLOW,
+	ANIM_WAIT, ANIM_TICKS(200),
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 7, 7), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 7, 0), COL_GREEN,
+	ANIM_PIXEL, ANIM_AT(ANIM_M0, 4, 4), COL_GREEN,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 7, 0), COL_BLACK,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 7, 7), COL_GREEN,
+	ANIM_PIXEL, ANIM_AT(ANIM_M1, 4, 3), COL_GREEN,
+	ANIM_WAIT, ANIM_TICKS(200),
+	ANIM_LOOP, ANIM_FOREVER
+};
+
+#endif // _ANIMATIONS_H_
@@ -21,23 +21,78 @@
 ****************************************************************************/
 // stat_flag
 //#define stat_flag		GPIOR0
-#define SET_LEDS		0x01
-#define UPDATE_LEDS		0x02
-#define TWI_DONE		0x08
+#define SET_LEDS		0x01	// Start the chase sequence from the top
+#define SAVE_REFUSED	0x02	// The last FRAME_SAVE was not saved (STATUS_NOT_SAVED)
+#define SWAP_LEDS		0x04
+#define TWI_DONE		0x08	// TWI_streamBuf holds a message not read yet
 #define PASSIVE_MODE	0x10
-#define RESET_CHASE		0x20
-#define INCREMENT_COLOR	0x40
-#define DECREMENT_COLOR	0x80
+#define FRAME_READY		0x20	// Back buffer waits for a GC_LATCH (REG_SYNC)
+#define DIRECT_MODE		0x40	// Colors from the bus master are direct pixels (REG_FORMAT)
 
 #define FLAG_IS_SET(FLAG)	(stat_flags & (FLAG))
 #define FLAG_IS_CLEAR(FLAG)	!FLAG_IS_SET(FLAG)
 #define SET_FLAG(FLAG)		stat_flags |= (FLAG)
 #define CLEAR_FLAG(FLAG)	stat_flags &= ~(FLAG)
 
-#define TWI_IS_DONE			(stat_flag & TWI_DONE)
+#define TWI_IS_DONE			FLAG_IS_SET(TWI_DONE)
 #define TWI_NOT_DONE		!TWI_IS_DONE
 
-#define WDT_MAX		70
+// Front/back LED buffers, swapped by the ISR at column 0
+#define REQUEST_SWAP()		do { _MEMORY_BARRIER(); SET_FLAG(SWAP_LEDS); } while(0)
+#define SWAP_IS_PENDING		FLAG_IS_SET(SWAP_LEDS)
+#define SWAP_IS_DONE		FLAG_IS_CLEAR(SWAP_LEDS)
+
+// Millisecond tick from Timer2 (CTC, prescaler 64), wraps every 65.5 s
+#define TICK_OCR			((F_CPU / 64 / 1000) - 1)
+#define TICK_HAS_PASSED(T)	((int16_t)(read_ticks() - (T)) >= 0)
+#define TICKS_SINCE(T)		((uint16_t)(read_ticks() - (T)))
+
+// Idle time before falling back to SMILEY (see REG_IDLE)
+#define IDLE_TIMEOUT		7000	// ms, 0: never
+#define HW_WDT_TIMEOUT		WDTO_250MS	// Main loop hang (see HW_WATCHDOG)
+
+// LED Modulation - select with PWM_MODE at compile time
+#define PWM_LINEAR		0	// One interrupt per color level (2 bit colors)
+#define PWM_BAM			1	// Bit angle modulation, one interrupt per color bit
+
+#ifndef PWM_MODE
+#define PWM_MODE		PWM_LINEAR
+#endif
+
+#if PWM_MODE == PWM_BAM
+
+#ifndef COLOR_DEPTH
+#define COLOR_DEPTH		6	// Bits per R, G, & B level [2, 6]
+#endif
+
+#define BAM_UNIT		5	// Timer0 counts (/64 prescaler) shown for bit 0
+#define BAM_OCR(PLANE)	((BAM_UNIT << (PLANE)) - 1)
+
+#define COLOR_PLANES	COLOR_DEPTH		// One bit plane per color bit
+#define PWM_PERIODS		COLOR_PLANES	// Timer0 interrupts per column
+
+#define LED_IS_ON(LEVEL, PLANE)	((LEVEL) & _BV(PLANE))	// Bit N of the level
+
+#if (BAM_UNIT << (COLOR_DEPTH - 1)) > 256
+#error "BAM_UNIT too large for COLOR_DEPTH, OCR0A would overflow!"
+#endif
+
+#elif PWM_MODE == PWM_LINEAR
+
+#ifndef COLOR_DEPTH
+#define COLOR_DEPTH		2
+#endif
+
+#define COLOR_PLANES	((1 << COLOR_DEPTH) - 1)	// One bit plane per level
+#define PWM_PERIODS		(COLOR_PLANES + 1)			// Timer0 interrupts per column
+
+#define LED_IS_ON(LEVEL, PLANE)	((LEVEL) > (PLANE))		// Level above N
+
+#else
+
+#error "Unknown PWM_MODE!"
+
+#endif	// PWM_MODE
 
 // Color Control
 #define COLORS		3
@@ -51,6 +106,11 @@
 #define LEDS		8
 #define ROWS		LEDS
 
+// Column Flags, 1 bit for each column of a matrix
+#define ALL_COLUMNS		0xFF
+#define LEFT_COLUMNS	0x0F	// Columns [0, 3]
+#define RIGHT_COLUMNS	0xF0	// Columns [4, 7]
+
 // Quadrant Flags for 2 matrices
 #define QUAD00		0x01
 #define QUAD01		0x02
@@ -64,8 +124,207 @@
 /***************************************************************************
 	TWI Macros
 ****************************************************************************/
-#define TWI_SLAVE_ADDRESS	0x47
-#define TWI_MSG_SIZE		2
+#define TWI_SLAVE_ADDRESS	0x47	// Used until one is saved in EEPROM (see REG_ADDRESS)
+#define TWI_ADDRESS_MIN		0x08	// 7 bit addresses not reserved by I2C
+#define TWI_ADDRESS_MAX		0x77
+#define ADDRESS_KEY			0xA5	// REG_KEY value that unlocks REG_ADDRESS
+#define TWI_MSG_SIZE		2		// Register + data, a single byte is a quad_flags message
+#define TWI_BUFFER_SIZE		32		// Commands queued for the main loop, power of 2
+
+#define COMMAND_MASK		(TWI_BUFFER_SIZE - 1)
+#define NEXT_COMMAND(INDEX)	(((INDEX) + 1) & COMMAND_MASK)
+#define COMMANDS_WAITING	(cmd_head != cmd_tail)
+#define COMMANDS_FULL		(NEXT_COMMAND(cmd_head) == cmd_tail)
+
+#if TWI_BUFFER_SIZE & COMMAND_MASK
+#error "TWI_BUFFER_SIZE must be a power of 2!"
+#endif
+
+/***************************************************************************
+	TWI Registers - write [register, data, data, ...] in one transaction
+	The register increments after every data byte, so the drawing
+	registers and REG_DRAW can all be set by the same message.
+****************************************************************************/
+#define REG_CHASE			0x00	// Chase sequence (see below)
+#define REG_QUADS			0x01	// Quadrant flags (see QUAD00)
+#define REG_COLOR			0x02	// Color to draw, [0, PALETTE_COLORS - 1]
+#define REG_MATRIX			0x03	// Matrix to draw [0, 1]
+#define REG_ROW				0x04	// Row to draw [0, 7]
+#define REG_COLUMN			0x05	// Column to draw [0, 7]
+#define REG_QUAD			0x06	// Quadrant to draw [0, 3]
+#define REG_DRAW			0x07	// Draw operation, runs when written
+#define REG_READ			0x08	// Where the next SLA+R read starts (see READ_FW_VERSION)
+#define REG_SYNC			0x09	// 1: frames wait for a general call GC_LATCH, 0: shown when ready
+#define REG_KEY				0x0A	// ADDRESS_KEY, then REG_ADDRESS may be written once
+#define REG_ADDRESS			0x0B	// New slave address, saved in EEPROM
+#define REG_IDLE			0x0C	// Idle timeout in ms, LSB (see IDLE_TIMEOUT)
+#define REG_IDLE_HI			0x0D	// Idle timeout MSB, applies both bytes
+#define REG_SLOT			0x0E	// Show frame slot [0, FRAME_SLOTS - 1], or save one (FRAME_SAVE)
+#define REG_FORMAT			0x0F	// Colors sent from now on: FORMAT_PALETTE or FORMAT_DIRECT
+#define TWI_REGISTERS		16
+
+// Queued for a message of one byte (quadrant flags), not a TWI register
+#define CMD_QUADS			0xFF
+
+// REG_FORMAT - how REG_COLOR, frames, runs & deltas are read
+#define FORMAT_PALETTE		0x00	// Palette colors [0, PALETTE_COLORS - 1], see COL_BLACK
+#define FORMAT_DIRECT		0x01	// R, G & B levels in the color itself, see PIXEL_RGB
+
+// REG_DRAW operations - these stop the chase sequence (ALL_CONSTANT)
+#define DRAW_NONE			0x00
+#define DRAW_LED			0x01	// REG_MATRIX, REG_ROW, REG_COLUMN
+#define DRAW_ROW			0x02	// REG_MATRIX, REG_ROW
+#define DRAW_COLUMN			0x03	// REG_MATRIX, REG_COLUMN
+#define DRAW_QUAD			0x04	// REG_MATRIX, REG_QUAD
+#define DRAW_MATRIX			0x05	// REG_MATRIX
+#define DRAW_QUADS			0x06	// Quadrants set in REG_QUADS, others off
+#define DRAW_OFF			0x07	// Both matrices off, color not used
+
+// REG_DRAW commands (see command_t) carry the drawing registers as they were
+// when REG_DRAW was written, so the messages after it may change them first
+#define CMD_DRAW(OP, MTRX, QUAD)	((OP) | ((MTRX) << 3) | ((QUAD) << 4))
+#define CMD_OP(DATA)		((DATA) & 0x07)
+#define CMD_MATRIX(DATA)	(((DATA) >> 3) & 0x01)
+#define CMD_QUAD(DATA)		((DATA) >> 4)
+#define CMD_AT(ROW, COL)	(((ROW) << 3) | (COL))
+#define CMD_ROW(AT)			((AT) >> 3)
+#define CMD_COLUMN(AT)		((AT) & 0x07)
+
+// Stream registers - every data byte in the message belongs to one register.
+// Pixels are numbered in the order of colors[][][], see FRAME_BYTES.
+#define REG_FRAME			0x10	// Whole frame of both matrices, see FRAME_BYTES
+#define REG_RUNS			0x11	// [count, color] runs from pixel 0, COLOR_SKIP keeps pixels
+#define REG_DELTAS			0x12	// [pixel, color] pairs, for scattered changes
+#define REG_PROGRAM			0x13	// [slot, offset, bytes...] of a program saved in EEPROM
+#define REG_PALETTE			0x14	// [first, red, green, blue...] colors saved in EEPROM
+#define REG_RGB				0x15	// [first pixel, red, green, blue...] 8 bit colors (DITHER_RGB)
+#define REG_STREAM_LAST		REG_RGB		// Registers after it are ignored
+#define STREAM_BYTES		FRAME_BYTES		// Most data bytes in a stream message
+#define COLOR_SKIP			0xFF	// Run of pixels left as they are
+
+#if CMD_QUADS < TWI_REGISTERS || (CMD_QUADS >= REG_FRAME && CMD_QUADS <= REG_STREAM_LAST)
+#error "CMD_QUADS must not be a TWI register!"
+#endif
+
+// Frames are 6 bit colors (see COLOR_MASK) packed LSB first, 4 pixels in 3 bytes,
+// for matrix 0 then 1, column 0 to 7, row 0 to 7 (the order of colors[][][]).
+// 96 bytes + SLA+W + REG_FRAME is 882 bit times, 2.2 ms at 400 kHz.
+#define FRAME_PIXELS		(MATRICES * COLUMNS * LEDS)
+#define PIXEL_BITS			6
+#define FRAME_BYTES			(FRAME_PIXELS * PIXEL_BITS / 8)
+#define PIXEL_COLUMN(PIXEL)	(((PIXEL) >> 3) & (COLUMNS - 1))	// Column of pixel [0, 127]
+
+// Pixels of colors[][][] - a palette color (see COLOR_LEVELS), or PIXEL_DIRECT
+// with R, G & B levels [0, 3] in the lower 6 bits. Both can be shown at once.
+#define PIXEL_DIRECT		0x40
+#define PIXEL_RGB(R, G, B)	(PIXEL_DIRECT | (R) | ((G) << 2) | ((B) << 4))
+#define PIXEL_RED(PIXEL)	((PIXEL) & 0x03)
+#define PIXEL_GREEN(PIXEL)	(((PIXEL) >> 2) & 0x03)
+#define PIXEL_BLUE(PIXEL)	(((PIXEL) >> 4) & 0x03)
+#define IS_PIXEL(COLOR)		((COLOR) < PALETTE_COLORS || ((COLOR) & ~COLOR_MASK) == PIXEL_DIRECT)
+#define PIXEL_DITHER		0x80	// 8 bit color in dither_levels (REG_RGB)
+
+// 8 bit colors are gamma corrected (GAMMA_LEVELS) and kept as LED levels with
+// DITHER_BITS more. A level with a fraction of N / DITHER_STEPS is shown one
+// level up in N of every DITHER_STEPS frames. Frames step in DITHER_ORDER, from
+// a phase of each pixel (DITHER_OFFSET), so neighbours don't change together.
+// Duty is not linear in level: the top level is also on in the last of the
+// PWM_PERIODS, so levels 0-3 are on for 0, 1, 2 & 4 of 4 periods. The gamma
+// corrected color is a duty (DITHER_DUTY_MAX at 255), and the fraction is of the
+// duty step to the next level, two periods from DITHER_TOP up.
+#define DITHER_BITS			4
+#define DITHER_STEPS		(1 << DITHER_BITS)
+#define DITHER_MASK			(DITHER_STEPS - 1)
+#define DITHER_MAX			(COLOR_MAX_RESOLUTION << DITHER_BITS)	// 8 bit level 255
+#define DITHER_TOP			((COLOR_MAX_RESOLUTION - 1) << DITHER_BITS)	// Level below the top
+#define DITHER_DUTY_MAX		(PWM_PERIODS << DITHER_BITS)	// Duty in DITHER_STEPS of a period
+#define DITHER_OFFSET(LED, COL)	((((LED) & 0x03) << 2) | ((COL) & 0x03))
+
+// Frame slots in EEPROM, packed as REG_FRAME but inverted (see ee_frames). Only
+// the 6 color bits are saved, with the kind of pixel for the whole slot, so a
+// frame mixing palette, direct and 8 bit pixels is not saved (STATUS_NOT_SAVED).
+#define FRAME_SLOTS			4
+#define FRAME_SAVE			0x80	// REG_SLOT + slot: save the frame shown in the slot
+
+// Palette colors, uploaded with REG_PALETTE as levels [0, 255] scaled to COLOR_DEPTH.
+// Colors never uploaded are the built-in COLOR_LEVELS, or black from UNIQUE_COLORS on.
+// REG_PALETTE + [first] alone restores the built-in colors from first on.
+#define PALETTE_COLORS		64		// Every 6 bit color (see COLOR_MASK)
+#define PALETTE_BIT(COLOR)	_BV((COLOR) & 0x07)		// Of the color in ee_palette_set
+
+/***************************************************************************
+	TWI Read Registers - SLA+R sends these in order, from REG_READ
+	A snapshot is taken at SLA+R, so every byte of one read agrees.
+****************************************************************************/
+#define READ_FW_VERSION		0x00
+#define READ_HW_VERSION		0x01
+#define READ_STATUS			0x02	// See STATUS_STREAM_FREE
+#define READ_CHASE			0x03	// Chase sequence shown
+#define READ_QUEUE_FREE		0x04	// Commands that can be queued now (see command_t)
+#define READ_OVERFLOWS		0x05	// Messages NACKed, queue full (saturates)
+#define READ_COLOR_DEPTH	0x06	// Bits per R, G, & B level
+#define READ_PWM_MODE		0x07	// PWM_LINEAR or PWM_BAM
+#define READ_STATS			0x08	// ISR statistics, if ISR_STATS (see isr_stats_t)
+
+// READ_STATUS
+#define STATUS_STREAM_FREE	0x01	// A stream message (REG_FRAME...) will be taken
+#define STATUS_QUEUE_EMPTY	0x02	// Every register write has been run
+#define STATUS_LATCHED		0x04	// Everything received so far is being shown
+#define STATUS_PASSIVE		0x08	// No messages for a while, back to SMILEY
+#define STATUS_READY		0x10	// A frame is waiting for GC_LATCH
+#define STATUS_SYNC			0x20	// REG_SYNC is on
+#define STATUS_DIRECT		0x40	// REG_FORMAT is FORMAT_DIRECT
+#define STATUS_NOT_SAVED	0x80	// The last FRAME_SAVE mixed kinds of pixel, slot unchanged
+
+/***************************************************************************
+	TWI General Call - one write to every board on the bus (REG_SYNC)
+	Boards with REG_SYNC on show their waiting frame at their next
+	column 0, so the displays of all boards change together.
+****************************************************************************/
+#define GC_LATCH			0x4C	// Show the waiting frame ('L')
+
+#define SYNC_IS_ON			(TWAR & _BV(TWGCE))
+
+/***************************************************************************
+	USART Link (UART_LINK) - the TWI messages, point to point
+	Packet: UART_SYNC, length, message (length bytes), CRC-8 CCITT
+	(from 0, of the length & message). Each packet is answered with
+	UART_ACK once run, or UART_NAK if the CRC is wrong or a byte was
+	lost (framing error or overrun), and packets sent before the answer
+	are dropped. After a NAK, bytes are skipped up to the next UART_SYNC
+	received whole, so the rest of a broken packet is not NAKed again.
+	2 Mbaud builds, but bytes come every 80 cycles and the USART
+	overruns while the LED ISR runs (tests/test_uart.c), so 1 Mbaud
+	is the fastest that works.
+****************************************************************************/
+#ifndef UART_BAUD
+#define UART_BAUD			1000000		// U2X0, F_CPU / 8 / UART_BAUD must be whole
+#endif
+#define UART_SYNC			0xAA
+#define UART_MSG_SIZE		(STREAM_BYTES + 1)	// Register + data, as over TWI
+#define UART_ACK			0x06
+#define UART_NAK			0x15
+
+// USART receive states
+#define UART_WAIT_SYNC		0
+#define UART_LENGTH			1
+#define UART_DATA			2
+#define UART_CRC			3
+#define UART_FULL			4	// Packet waits for the main loop
+#define UART_LOST			5	// Byte lost, the main loop sends UART_NAK
+#define UART_RESYNC			6	// After a NAK, as UART_WAIT_SYNC but errors are ignored
+
+/***************************************************************************
+	ISR Statistics
+****************************************************************************/
+#define STATS_SAMPLES		64				// ISR durations in each average
+#define STATS_WINDOW		(F_CPU / 65536)	// Timer1 overflows in ~1 second
+
+// Benchmark (make benchmark)
+#define BENCH_WINDOWS		2		// Seconds to run each chase sequence
+#define BENCH_BAUD			1000000
+
+#define HEX_DIGIT(NIBBLE)	((NIBBLE) < 10 ? '0' + (NIBBLE) : 'A' - 10 + (NIBBLE))
 
 /***************************************************************************
 	Chase Sequences - 255 possible
@@ -91,12 +350,60 @@
 
 // Miscellaneous
 #define SMILEY				0xE0
-#define SMILEY_EYE_DELAY	150		// * 10 ms
+#define SMILEY_LOOK_TIME	200		// ms
+#define SMILEY_EYE_DELAY	1500	// ms
+
+// Step time of sequences that don't change by themselves
+#define CHASE_IDLE_TIME		100		// ms
 
 // Tests
 #define TEST_CORNERS		0xF0
 #define ALL_OFF				0xFF
 
+// User Programs, uploaded with REG_PROGRAM
+#define USER_PROGRAM		0x80	// + slot [0, ANIM_SLOTS - 1]
+#define IS_USER_PROGRAM(CHASE)	((uint8_t)((CHASE) - USER_PROGRAM) < ANIM_SLOTS)
+
+/***************************************************************************
+	Animation Programs - chase sequences played from flash (animations.h)
+	Each op byte is followed by its operands. step_chase runs ops until
+	ANIM_WAIT, then shows the frame and comes back when the wait is over.
+****************************************************************************/
+#define ANIM_END			0x00	// Hold the frame, the program is over
+#define ANIM_PIXEL			0x01	// at, color
+#define ANIM_RECT			0x02	// at, to, color - rows & columns from at to to
+#define ANIM_QUAD			0x03	// at, color - quadrant [0, 3] in the column of at
+#define ANIM_QUADS			0x04	// color - quadrants set in quad_flags, others off
+#define ANIM_WAIT			0x05	// ticks of ANIM_TICK ms, then the next step
+#define ANIM_MARK			0x06	// Where ANIM_LOOP goes back to (the start until set)
+#define ANIM_LOOP			0x07	// count - run from the mark count times, ANIM_FOREVER: 0
+#define ANIM_COLOR			0x08	// step - add to the color register (int8_t), skipping black
+#define ANIM_COUNT_ROWS		0x09	// at, color - counter bits as rows, then count up
+#define ANIM_COUNT_COLS		0x0A	// at, color - counter bits as columns, then count up
+
+// Operands
+#define ANIM_M0				0x40	// Matrices to draw on
+#define ANIM_M1				0x80
+#define ANIM_BOTH			(ANIM_M0 | ANIM_M1)
+#define ANIM_AT(MTRX, ROW, COL)	((MTRX) | ((ROW) << 3) | (COL))
+#define ANIM_ROW(AT)		(((AT) >> 3) & (ROWS - 1))
+#define ANIM_COL(AT)		((AT) & (COLUMNS - 1))
+#define ANIM_MATRIX(MTRX)	(ANIM_M0 << (MTRX))
+
+#define ANIM_COLOR_REG		0xFE	// Color register instead of a color
+#define ANIM_STEP_UP		0x01
+#define ANIM_STEP_DOWN		0xFF
+#define ANIM_FOREVER		0
+
+#define ANIM_TICK			10		// ms
+#define ANIM_TICKS(MS)		((MS) / ANIM_TICK)
+#define ANIM_MAX_OPS		255		// Ops in one step, for programs with no ANIM_WAIT
+
+// EEPROM slots for user programs, played from a copy in RAM
+#define ANIM_SLOTS			4
+#define ANIM_SLOT_SIZE		96		// Bytes, blank (0xFF) bytes end the program
+#define ANIM_PAD			4		// ANIM_END after the copy, for an op cut off at the end
+
 /***************************************************************************
 	Firmware Version Constants
 ****************************************************************************/
@@ -154,6 +461,17 @@
 #define SET_HI(COLOR, MATRIX)	SDI_PORT ## MATRIX |= (SDI_ ## COLOR ## MATRIX)
 #define SET_LO(COLOR, MATRIX)	SDI_PORT ## MATRIX &= ~(SDI_ ## COLOR ## MATRIX)
 
+// Whole port writes - one byte holds every SDI line for one clock.
+// SDI_PORT0 bits are in place, SDI_PORT1 bits are shifted up by SDI_SHIFT1.
+// SCK is on SDI_PORT0, so it is clocked by the same port writes.
+#define SDI_MASK0		(SDI_R0 | SDI_G0 | SDI_B0)
+#define SDI_MASK1		(SDI_R1 | SDI_G1 | SDI_B1)
+#define SDI_SHIFT1		4
+
+#if (SDI_MASK0 & (SDI_MASK1 << SDI_SHIFT1)) || ((SDI_MASK1 << SDI_SHIFT1) > 0xFF)
+#error "SDI pins do not fit in one byte with SDI_SHIFT1!"
+#endif
+
 // LED Output Enable
 #define OE_PORT			PORTB
 #define LED_OE			_BV(PB3)
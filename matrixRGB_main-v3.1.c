@@ -22,22 +22,53 @@
   Completed
 	- Individual Color Control of Every RGB in 2 Matrices
 	- RGB Color Resolution: [0, 3] (64 possible colors)
+	- Bit Angle Modulation Mode: up to 6 bits per color (PWM_MODE)
+	- ISR Timing and Frame Rate Readable Via I2C (ISR_STATS)
 	- I2C Communication
 	- Quadrant Control Via I2C
+	- Register Mapped I2C Protocol: chase, color, LEDs, rows, columns, quadrants
+	- Whole Frames Via I2C: 6 bit packed colors, shown together (REG_FRAME)
+	- Compressed Updates Via I2C: color runs & changed pixels (REG_RUNS, REG_DELTAS)
+	- Frames of Many Boards Shown Together Via I2C General Call (REG_SYNC)
+	- I2C Slave Address Saved in EEPROM (REG_KEY, REG_ADDRESS)
+	- Messages Via USART at 1 Mbaud, with CRC (UART_LINK)
+	- Chase Sequences Stepped by a 1 ms Tick, Messages Handled Without Delay
+	- Idle Timeout in ms, Set Via I2C (REG_IDLE), Optional Hardware Watchdog
+	- Chase Sequences as Animation Programs in Flash (animations.h)
+	- Animation Programs Uploaded Via I2C, Saved in EEPROM (REG_PROGRAM)
+	- Frames Saved in EEPROM & Shown Again Via I2C (REG_SLOT)
+	- Direct RGB Pixels (2 bits each) Besides Palette Colors (REG_FORMAT)
+	- Palette of 64 Colors Uploaded Via I2C, Saved in EEPROM (REG_PALETTE)
+	- 8 Bit Colors Via I2C, Gamma Corrected & Dithered Over Frames (DITHER_RGB)
 
   Working On
-	- Better loop delays (to avoid delay in quadrant control)
 	- Disable servos (set IO pin HI) during Screen saver time
 	- Initial Chase Sequence Setup Phase
 	- Chase Sequences
 
   Additional Notes
+	- TIMER0_COMPA_vect cycles were never measured, before or after the
+	  bit planes moved out of it (render_column). Measure them with
+	  make benchmark (T0_MIN, T0_MAX, T0_AVG), in simavr.
 
 ***************************************************************************/
  
 /**************************************************************************
 	Definitions for Conditional Code
 ***************************************************************************/
+//#define ISR_STATS	// Time ISRs with Timer1, readable over TWI (SLA+R)
+//#define BENCHMARK	// Run every chase sequence, print ISR_STATS on USART0 (make benchmark)
+//#define UART_LINK	// Take TWI messages over USART0 too, see UART_SYNC
+//#define HW_WATCHDOG	// Reset if the main loop hangs (HW_WDT_TIMEOUT)
+//#define DITHER_RGB	// Take 8 bit colors (REG_RGB), dithered over frames (DITHER_BITS)
+
+#ifdef BENCHMARK
+#define ISR_STATS
+#endif
+
+#if defined(BENCHMARK) && defined(UART_LINK)
+#error "BENCHMARK and UART_LINK both use USART0!"
+#endif
 
 /**************************************************************************
 	Included Header Files
@@ -46,7 +77,40 @@
 #include "definitions.h"
 #include "modules/macros/color_8bit.h"
 #include "modules/twi/twi.h"
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
 #include <util/delay.h>
+#ifdef UART_LINK
+#include <util/crc16.h>
+#endif
+#ifdef HW_WATCHDOG
+#include <avr/wdt.h>
+#endif
+#ifdef BENCHMARK
+#include <avr/sleep.h>
+#endif
+#include "animations.h"
+
+#if PALETTE_COLORS > PIXEL_DIRECT
+#error "Palette colors must not have the PIXEL_DIRECT bit!"
+#endif
+
+#if UNIQUE_COLORS > PALETTE_COLORS
+#error "Built-in colors do not fit in the palette!"
+#endif
+
+#if defined(DITHER_RGB) && PWM_MODE == PWM_BAM
+#error "DITHER_RGB is for PWM_LINEAR, BAM has the depth already (and not the RAM)!"
+#endif
+
+#if defined(DITHER_RGB) && DITHER_MAX > 0xFF
+#error "DITHER_BITS too large for COLOR_DEPTH, dither levels would overflow!"
+#endif
+
+#if defined(UART_LINK) && (F_CPU / 8) % UART_BAUD
+#error "UART_BAUD is not a whole divisor of F_CPU / 8!"
+#endif
 
 /**************************************************************************
 	Definitions for Testing Purposes Only
@@ -59,23 +123,171 @@
 
 #define chase_sequence 	PCMSK0	// actuve chase sequence
 #define column			PCMSK1	// Current active column [0, 7]
-#define TWI_msgBuf		PCMSK2	// Message Buffer for TWI bus
+#define TWI_rxLen		PCMSK2	// Bytes received in this message, up to TWI_MSG_SIZE (not stream data)
 
-#define OCR0A_cnt		EEARH	// Counter for the OCR0A timer
+//#define EEARH
 //#define EEDR
 //#define EEARL	
 
 #define stat_flags		GPIOR0	// Status flags
 #define	quad_flags		GPIOR1	// 1 bit for each quadrant of 2 matrices
-//#define GPIOR2
+#define OCR0A_cnt		GPIOR2	// Counter for the OCR0A timer (current bit plane)
 
 static volatile bool	TWI_isBusy = false;
 
-// 1 bit for each RGB in each column
-static volatile uint8_t leds[MATRICES][COLUMNS][COLORS];
+static volatile uint16_t	ticks = 0;	// Milliseconds, counted by Timer2
+static uint16_t				idle_timeout = IDLE_TIMEOUT;	// ms without a message, 0: never
+
+// Animation program being played by step_chase (see ANIM_END)
+typedef struct {
+	const uint8_t	*pc;		// Next op, in flash or anim_cache - NULL if not a program
+	const uint8_t	*mark;		// Where ANIM_LOOP goes back to
+	uint8_t			color;		// Color register (ANIM_COLOR_REG)
+	uint8_t			count;		// Counter of ANIM_COUNT_ROWS & ANIM_COUNT_COLS
+	uint8_t			loops;		// Runs left in a counted ANIM_LOOP, 0 if none
+	bool			in_ram;		// Playing a user program from anim_cache
+} anim_t;
+
+static anim_t	anim = {NULL, NULL, UNIQUE_COLORS - 1, 0, 0, false};
+
+#define ANIM_FETCH()	(anim.in_ram ? *anim.pc++ : pgm_read_byte(anim.pc++))
+
+// Commands from the bus master, queued by TWI_vect for the main loop. Only
+// register writes that do something are queued, with the values of the
+// registers they use (see write_register), so a message takes one slot.
+// Only TWI_vect moves cmd_head, and only the main loop moves cmd_tail.
+typedef struct {
+	uint8_t	reg;	// TWI register, stream register or CMD_QUADS
+	uint8_t	data;	// Value, CMD_DRAW, or data bytes in TWI_streamBuf for a stream
+	uint8_t	arg;	// REG_DRAW: REG_COLOR, REG_IDLE_HI: REG_IDLE
+	uint8_t	at;		// REG_DRAW: CMD_AT of REG_ROW & REG_COLUMN
+} command_t;
+
+static volatile command_t	cmd_ring[TWI_BUFFER_SIZE];
+static volatile uint8_t		cmd_head = 0;
+static volatile uint8_t		cmd_tail = 0;
+static volatile uint8_t		cmd_overflows = 0;	// Messages NACKed, ring full (saturates)
+
+static uint8_t	TWI_rxReg = 0;			// Register for the next data byte
+static bool		TWI_rxStream = false;	// Data bytes go in TWI_streamBuf
+
+// Data of the last stream message (see REG_FRAME), read when TWI_DONE is set
+static volatile uint8_t	TWI_streamBuf[STREAM_BYTES];
+static volatile uint8_t	*TWI_rxPtr = TWI_streamBuf;	// Where the next stream byte goes
+
+// TWI register values (see REG_CHASE)
+static uint8_t	twi_regs[TWI_REGISTERS];
+
+#ifdef UART_LINK
+// Last packet from the USART, read by the main loop in UART_FULL
+static volatile uint8_t	uart_buf[UART_MSG_SIZE];
+static volatile uint8_t	uart_len = 0;		// Message bytes in the packet
+static volatile uint8_t	uart_crc = 0;		// CRC received
+static volatile uint8_t	uart_state = UART_WAIT_SYNC;
+static uint8_t			uart_cnt = 0;		// Message bytes received so far
+#endif
+
+// Slave address, TWI_SLAVE_ADDRESS until changed (erased to 0xFF without EESAVE)
+static uint8_t EEMEM	ee_twi_address = TWI_SLAVE_ADDRESS;
+
+// User programs (see USER_PROGRAM), and a copy of the one playing
+static uint8_t EEMEM	ee_programs[ANIM_SLOTS][ANIM_SLOT_SIZE];
+static uint8_t			anim_cache[ANIM_SLOT_SIZE + ANIM_PAD];
+
+// Saved frames, packed as REG_FRAME but inverted (see REG_SLOT), so a slot
+// never saved is black, erased or as set in the .eep file
+static uint8_t EEMEM	ee_frames[FRAME_SLOTS][FRAME_BYTES] = {[0 ... FRAME_SLOTS - 1] = {[0 ... FRAME_BYTES - 1] = 0xFF}};
+static uint8_t EEMEM	ee_frames_direct = 0xFF;	// A bit cleared for each slot of direct pixels
+
+// Uploaded palette colors, and a bit cleared for each one (see PALETTE_BIT),
+// set in the .eep file as when erased, so every color starts built-in
+static uint8_t EEMEM	ee_palette[PALETTE_COLORS][RGB_LEVELS];
+static uint8_t EEMEM	ee_palette_set[PALETTE_COLORS / 8] = {[0 ... PALETTE_COLORS / 8 - 1] = 0xFF};
+
+// SDI port bits of each palette color for every bit plane (see expand_levels)
+static uint8_t	palette_planes[PALETTE_COLORS][COLOR_PLANES];
+
+#ifdef DITHER_RGB
+// Levels of PIXEL_DITHER pixels, with DITHER_BITS of fraction (see read_rgb)
+static uint8_t	dither_levels[MATRICES][COLUMNS][LEDS][RGB_LEVELS];
+static uint8_t	dither_columns = 0;		// Columns with PIXEL_DITHER pixels, kept by render_column
+static uint8_t	dither_phase = 0;		// Frame of DITHER_ORDER, stepped by step_dither
+static uint8_t	dither_dirty[2] = {0, 0};	// Of dirty_columns, the ones only step_dither changed
+
+// Frames each fraction of a level is shown in - bit reversed, so they spread out
+static const uint8_t DITHER_ORDER[DITHER_STEPS] PROGMEM = {
+	0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15
+};
+#endif
+
+// SDI port bits for each LED in each column, for every bit plane (see render_column)
+// Front buffer is shifted out by the ISR, back buffer is written by show_matrices
+static uint8_t leds[2][COLUMNS][COLOR_PLANES][LEDS];
+static const uint8_t (* volatile leds_front)[COLOR_PLANES][LEDS] = leds[0];
 
 // the actual color of each RGB (see color_8bit.h)
-static volatile uint8_t	colors[MATRICES][COLUMNS][LEDS];
+static uint8_t	colors[MATRICES][COLUMNS][LEDS];
+
+// 1 bit for each column changed since it was encoded into each LED buffer
+static uint8_t	dirty_columns[2] = {ALL_COLUMNS, ALL_COLUMNS};
+
+#ifdef ISR_STATS
+// ISR durations in CPU cycles - sent over TWI in this order, LSB first
+typedef struct {
+	uint16_t	min;
+	uint16_t	max;
+	uint16_t	avg;
+} isr_time_t;
+
+typedef struct {
+	isr_time_t	timer0;
+	isr_time_t	twi;
+	uint16_t	fps;	// Frames shown in the last second
+} isr_stats_t;
+
+static isr_stats_t	isr_stats = {{0xFFFF, 0, 0}, {0xFFFF, 0, 0}, 0};
+static uint32_t		timer0_sum = 0;
+static uint32_t		twi_sum = 0;
+static uint8_t		timer0_cnt = 0;
+static uint8_t		twi_cnt = 0;
+static uint16_t		frame_cnt = 0;
+static uint8_t		timer1_ovf = 0;
+static volatile uint8_t	fps_windows = 0;	// Times fps was updated
+
+/**
+ * Record the duration of an ISR, from START (TCNT1 at entry) to now.
+ * Doesn't include the ISR prologue and epilogue.
+ */
+#define RECORD_ISR_TIME(TIME, SUM, CNT, START)	do {	\
+	uint16_t cycles = TCNT1 - (START);					\
+	if (cycles < (TIME).min) (TIME).min = cycles;		\
+	if (cycles > (TIME).max) (TIME).max = cycles;		\
+	(SUM) += cycles;									\
+	if (++(CNT) == STATS_SAMPLES) {						\
+		(TIME).avg = (SUM) / STATS_SAMPLES;				\
+		(SUM) = 0;										\
+		(CNT) = 0;										\
+	}													\
+} while(0)
+#endif	// ISR_STATS
+
+// Snapshot of the read registers being sent to the bus master (see READ_FW_VERSION)
+#ifdef ISR_STATS
+static uint8_t	TWI_txBuf[READ_STATS + sizeof(isr_stats_t)];
+#else
+static uint8_t	TWI_txBuf[READ_STATS];
+#endif
+static uint8_t	TWI_txIndex = 0;
+static uint8_t	TWI_readReg = 0;	// Set by REG_READ
+
+#ifdef BENCHMARK
+// Every chase sequence in definitions.h
+static const uint8_t BENCH_SEQUENCES[] = {
+	ALL_CONSTANT, LOOP_ALL, ALL_WHITE, ALL_COLORS, BINARY_ROWS,
+	BINARY_COLS, COLOR_SLIDE_COLS, QUAD_WHEEL, QUAD_WHEEL2, QUAD_WHEEL3,
+	LOOP_QUAD, SMILEY, TEST_CORNERS, ALL_OFF
+};
+#endif
 
 /**************************************************************************
     Local Function Prototypes
@@ -88,21 +300,67 @@ static void set_row(const uint8_t mtrx, const uint8_t row, const uint8_t color);
 static void set_led(const uint8_t mtrx, const uint8_t row, const uint8_t col, const uint8_t color);
 static void set_matrix(const uint8_t mtrx, const uint8_t color);
 static void turn_off_matrices(void);
+#ifdef BENCHMARK
+static void benchmark(void);
+static void reset_isr_stats(void);
+static void bench_print(const char *str);
+static void bench_print_u16(uint16_t num, uint8_t width);
+static void bench_print_hex(const uint8_t num);
+#endif
+static inline void queue_command(const command_t *cmd);
+static inline uint8_t read_status(void);
+static bool read_commands(void);
+static void run_command(const command_t *cmd);
+static void run_stream(const uint8_t reg, const volatile uint8_t *data, const uint8_t len);
+#ifdef UART_LINK
+static bool read_uart(void);
+#endif
+static void read_frame(const volatile uint8_t *data);
+static void unpack_pixels(const uint8_t b0, const uint8_t b1, const uint8_t b2, uint8_t *pixel, const bool direct);
+static inline uint8_t to_pixel(const uint8_t color);
+static void show_slot(const uint8_t slot);
+static void save_slot(const uint8_t slot);
+static void read_runs(const volatile uint8_t *data, const uint8_t len);
+static void read_deltas(const volatile uint8_t *data, const uint8_t len);
+static bool write_register(const uint8_t reg, const uint8_t data, command_t *cmd);
+static void run_register(const command_t *cmd);
+static void draw(const command_t *cmd);
+static void set_sync(const bool on);
+static uint8_t read_address(void);
+static void set_address(const uint8_t addr);
+static void mark_columns(const uint8_t cols);
+static void expand_levels(const uint8_t red, const uint8_t green, const uint8_t blue, uint8_t planes[COLOR_PLANES]);
+static void load_color(const uint8_t color);
+static void load_palette(void);
+static void write_palette(const volatile uint8_t *data, const uint8_t len);
+#ifdef DITHER_RGB
+static void read_rgb(const volatile uint8_t *data, const uint8_t len);
+static inline uint8_t dither_level(const uint8_t level, const uint8_t threshold);
+static void step_dither(void);
+#endif
+static void render_column(uint8_t planes[COLOR_PLANES][LEDS], const uint8_t col);
+static void show_matrices(void);
+static uint16_t step_chase(void);
+static const uint8_t *find_animation(const uint8_t chase);
+static const uint8_t *load_program(const uint8_t slot);
+static void write_program(const volatile uint8_t *data, const uint8_t len);
+static uint16_t play_animation(void);
+static void anim_draw(const uint8_t op, const uint8_t mtrx, const uint8_t at, const uint8_t to, const uint8_t color);
+static uint8_t anim_color(const uint8_t color);
+static uint8_t step_color(const uint8_t color, const int8_t step);
+static inline uint16_t read_ticks(void);
 
 /**************************************************************************
     Main
 ***************************************************************************/
 int main (void) 
 {
-	uint8_t color = UNIQUE_COLORS -1;
-	uint8_t row = 0;
-	uint8_t col = 0;
-	uint8_t quad = 0;
-	uint8_t binary_cnt = 0;
-	uint8_t wdt_cnt = 0;
-	uint8_t update_cnt = 0;
+	uint16_t next_step = 0;		// Tick of the next chase step
+	uint16_t last_message = 0;	// Tick of the last message
+	uint8_t last_chase = ALL_OFF;
 	
 	initialize_AVR();
+	load_palette();
 
 	SET_FLAG(SET_LEDS);
 	chase_sequence = SMILEY;
@@ -115,332 +373,356 @@ int main (void)
 	// Turn On TWI
 	TWI_RESET_WITH_ACK();
 
+#ifdef BENCHMARK
+	idle_timeout = 0;	// Don't fall back to SMILEY
+	chase_sequence = BENCH_SEQUENCES[0];
+	reset_isr_stats();
+	bench_print("\nBENCHMARK\n SEQ T0_MIN T0_MAX T0_AVG   FPS\n");
+#endif
+
 
 	/**********************************************
 	 *	MAIN LOOP
-	 *	- Handle Chase Sequences
+	 *	- Handle Messages as they come
+	 *	- Step Chase Sequences when due (never wait)
 	 **********************************************/
 	for(;;)
 	{
 		//-------------------------
-		// Handle Color Loops
+		// Handle TWI Messages
 		//-------------------------
-		if (FLAG_IS_SET(INCREMENT_COLOR)) {
-			if (++color == UNIQUE_COLORS)
-				color = 1;
-			CLEAR_FLAG(INCREMENT_COLOR);
-		}
-		else if (FLAG_IS_SET(DECREMENT_COLOR)) {
-			if (--color == 0)
-				color = UNIQUE_COLORS -1;
-			CLEAR_FLAG(DECREMENT_COLOR);
-		}
+#ifdef HW_WATCHDOG
+		wdt_reset();
+#endif
+
+		if (read_commands())
+			last_message = read_ticks();
+#ifdef UART_LINK
+		if (read_uart())
+			last_message = read_ticks();
+#endif
 
 		//-------------------------
-		// Reset Chase Sequence
+		// Handle Chase Sequences
+		//	- A new one starts now
 		//-------------------------
-		if (FLAG_IS_SET(RESET_CHASE)) {
-			wdt_cnt = 0;
-			chase_sequence = LOOP_QUAD;
-			CLEAR_FLAG(RESET_CHASE);
-			CLEAR_FLAG(PASSIVE_MODE);
-			ENABLE_SERVOS();
+		if (chase_sequence != last_chase) {
+			last_chase = chase_sequence;
+			SET_FLAG(SET_LEDS);
+		}
+		if (FLAG_IS_SET(SET_LEDS))
+			next_step = read_ticks();
+		if (TICK_HAS_PASSED(next_step)) {
+			next_step += step_chase();
+			CLEAR_FLAG(SET_LEDS);	// Every sequence is set up by now
 		}
 
 		//-------------------------
-		// Handle Chase Sequences
+		// Idle Timeout - once, until the next message
 		//-------------------------
-		switch (chase_sequence) {
+		if (FLAG_IS_CLEAR(PASSIVE_MODE) && idle_timeout &&
+			TICKS_SINCE(last_message) >= idle_timeout) {
+			DISABLE_SERVOS();
+			SET_FLAG(SET_LEDS);
+			SET_FLAG(PASSIVE_MODE);
+			set_sync(false);
+			chase_sequence = SMILEY;
+		}
 
-			//-------------------------
-			// Constant On at the last color
-			//-------------------------
-			case ALL_CONSTANT:
-				break;
+		// Show whatever the chase sequence or the messages changed
+#ifdef DITHER_RGB
+		step_dither();
+#endif
+		show_matrices();
+		
+#ifdef BENCHMARK
+		benchmark();
+#endif
 
-			//-------------------------
-			// Loop through all colors
-			//-------------------------
-			case LOOP_ALL:
-				SET_FLAG(DECREMENT_COLOR);
-				set_matrix(0, color);
-				set_matrix(1, color);
-				_delay_ms(100);
-				break;
-			
-			//-------------------------
-			// Color wheel - one color transistion per revolution
-			//-------------------------
-			case QUAD_WHEEL:
-				if (quad == 0) {
-					set_quadrant(0, 3, COL_BLACK);
-					set_quadrant(1, 3, COL_BLACK);
-				}
-				else {
-					set_quadrant(0, quad-1, COL_BLACK);
-					set_quadrant(1, quad-1, COL_BLACK);
-				}
-				set_quadrant(0, quad, color);
-				set_quadrant(1, quad, color);
-				if (++quad == QUADS) {
-					SET_FLAG(DECREMENT_COLOR);
-					quad = 0;
-				}
-				_delay_ms(50);
-				break;
+	}	// End of Main Loop
+}	// End of Main
 
-			//-------------------------
-			// Color wheel - change colors with quadrants
-			//-------------------------
-			case QUAD_WHEEL2:
-				SET_FLAG(DECREMENT_COLOR);
-				if (quad == 0) {
-					set_quadrant(0, 3, COL_BLACK);
-					set_quadrant(1, 3, COL_BLACK);
-				}
-				else {
-					set_quadrant(0, quad-1, COL_BLACK);
-					set_quadrant(1, quad-1, COL_BLACK);
-				}
-				set_quadrant(0, quad, color);
-				set_quadrant(1, quad, color);
-				if (++quad == QUADS) {
-					quad = 0;
-				}
-				_delay_ms(50);
-				
-				break;
+/**************************************************************************
+	CHASE SEQUENCES
+***************************************************************************/
 
-			//-------------------------
-			// Loop through all colors in Quadrant(s)
-			//-------------------------
-			case LOOP_QUAD:
-				SET_FLAG(DECREMENT_COLOR);
-				set_quadrants(color);
-				_delay_ms(100);
-				break;
+/**
+ * Run the next step of the chase sequence.
+ * Only changes the colors, the main loop shows them.
+ *
+ * @return	milliseconds until the next step
+ */
+static uint16_t step_chase(void)
+{
+	uint8_t row = 0;
+	uint8_t col = 0;
 
-			//-------------------------
-			// Binary Counter - by Columns
-			//-------------------------
-			case BINARY_COLS:
-				for (col = 0; col < COLUMNS; ++col) {
-					if (binary_cnt & _BV(col))
-						set_column(0, col, COL_BLUE);
-					else
-						set_column(0, col, COL_BLACK);
-				}
-				++binary_cnt;
-				_delay_ms(250);
-				break;
+	// Start from the top
+	if (FLAG_IS_SET(SET_LEDS)) {
+		anim.in_ram = IS_USER_PROGRAM(chase_sequence);
+		if (anim.in_ram)
+			anim.pc = load_program(chase_sequence - USER_PROGRAM);
+		else
+			anim.pc = find_animation(chase_sequence);
+		anim.mark = anim.pc;
+		anim.count = 0;
+		anim.loops = 0;
+	}
 
-			//-------------------------
-			// Binary Counter - by Row
-			//-------------------------
-			case BINARY_ROWS:
-				for (row = 0; row < ROWS; ++row) {
-					if (binary_cnt & _BV(row))
-						set_row(0, row, COL_RED);
-					else
-						set_row(0, row, COL_BLACK);
-				}
-				++binary_cnt;
-				_delay_ms(250);
-				break;
+	if (anim.pc != NULL)
+		return play_animation();
 
-			//-------------------------
-			// Display all colors
-			//-------------------------
-			case ALL_COLORS:
-				if (FLAG_IS_SET(SET_LEDS)) {
-					for (col = 0; col < COLUMNS; ++col) {
-						for (row = 0; row < ROWS; ++row) {
-							if (color < UNIQUE_COLORS) {
-								set_led(0, col, row, color);
-								++color;
-							}
-							else
-								set_led(0, col, row, COL_BLACK);
+	switch (chase_sequence) {
+
+		//-------------------------
+		// Constant On at the last color, or as drawn over TWI
+		//-------------------------
+		case ALL_CONSTANT:
+			return CHASE_IDLE_TIME;
+
+		//-------------------------
+		// Display all colors
+		//-------------------------
+		case ALL_COLORS:
+			if (FLAG_IS_SET(SET_LEDS)) {
+				for (col = 0; col < COLUMNS; ++col) {
+					for (row = 0; row < ROWS; ++row) {
+						if (anim.color < UNIQUE_COLORS) {
+							set_led(0, col, row, anim.color);
+							++anim.color;
 						}
+						else
+							set_led(0, col, row, COL_BLACK);
 					}
-					CLEAR_FLAG(SET_LEDS);
 				}
-				break;
+			}
+			return CHASE_IDLE_TIME;
 
-			//-------------------------
-			// Smiley Faces
-			//-------------------------
-			case SMILEY:
-				if (FLAG_IS_SET(SET_LEDS)) {
-					turn_off_matrices();
-
-					// Border
-					#define FACE_COLOR	COL_OLIVE
-					set_row(0, 0, FACE_COLOR);
-					set_row(0, 7, FACE_COLOR);
-					set_column(0, 0, FACE_COLOR);
-					set_column(0, 7, FACE_COLOR);
-
-					set_row(1, 0, FACE_COLOR);
-					set_row(1, 7, FACE_COLOR);
-					set_column(1, 0, FACE_COLOR);
-					set_column(1, 7, FACE_COLOR);
-
-					// Eyes
-					set_led(0, 1, 1, COL_WHITE);
-					set_led(0, 1, 2, COL_WHITE);
-					set_led(0, 2, 1, COL_WHITE);
-					set_led(0, 2, 2, COL_BLUE);
-
-					set_led(0, 1, 5, COL_WHITE);
-					set_led(0, 1, 6, COL_WHITE);
-					set_led(0, 2, 5, COL_WHITE);
-					set_led(0, 2, 6, COL_BLUE);
-
-					set_led(1, 1, 1, COL_WHITE);
-					set_led(1, 1, 2, COL_WHITE);
-					set_led(1, 2, 2, COL_WHITE);
-					set_led(1, 2, 1, COL_GREEN);
-
-					set_led(1, 1, 5, COL_WHITE);
-					set_led(1, 1, 6, COL_WHITE);
-					set_led(1, 2, 6, COL_WHITE);
-					set_led(1, 2, 5, COL_GREEN);
-
-					// Nose
-					set_led(0, 3, 4, FACE_COLOR);
-					set_led(0, 4, 3, FACE_COLOR);
-					set_led(0, 4, 4, FACE_COLOR);
-
-					set_led(1, 3, 3, FACE_COLOR);
-					set_led(1, 4, 3, FACE_COLOR);
-					set_led(1, 4, 4, FACE_COLOR);
-
-					// Mouth
-					set_led(0, 5, 1, COL_CORAL);
-					set_led(0, 6, 2, COL_CORAL);
-					set_led(0, 6, 3, COL_CORAL);
-					set_led(0, 6, 4, COL_CORAL);
-					set_led(0, 6, 5, COL_CORAL);
-					set_led(0, 5, 6, COL_CORAL);
-
-					set_led(1, 5, 1, COL_CORAL);
-					set_led(1, 6, 2, COL_CORAL);
-					set_led(1, 6, 3, COL_CORAL);
-					set_led(1, 6, 4, COL_CORAL);
-					set_led(1, 6, 5, COL_CORAL);
-					set_led(1, 5, 6, COL_CORAL);
-					CLEAR_FLAG(SET_LEDS);
-					SET_FLAG(UPDATE_LEDS);
-				}
+		//-------------------------
+		// Turn off all LEDs
+		//-------------------------
+		case ALL_OFF:
+		default:
+			if (FLAG_IS_SET(SET_LEDS))
+				turn_off_matrices();
+			return CHASE_IDLE_TIME;
+	}
+}
 
-					// Look back and forth
-				if (FLAG_IS_SET(UPDATE_LEDS)) {
-					set_led(0, 2, 2, COL_WHITE);
-					set_led(0, 2, 1, COL_BLUE);
-					set_led(0, 2, 6, COL_WHITE);
-					set_led(0, 2, 5, COL_BLUE);
-					set_led(1, 2, 1, COL_WHITE);
-					set_led(1, 2, 2, COL_GREEN);
-					set_led(1, 2, 5, COL_WHITE);
-					set_led(1, 2, 6, COL_GREEN);
-					_delay_ms(200);
-					set_led(0, 2, 1, COL_WHITE);
-					set_led(0, 2, 2, COL_BLUE);
-					set_led(0, 2, 5, COL_WHITE);
-					set_led(0, 2, 6, COL_BLUE);
-					set_led(1, 2, 2, COL_WHITE);
-					set_led(1, 2, 1, COL_GREEN);
-					set_led(1, 2, 6, COL_WHITE);
-					set_led(1, 2, 5, COL_GREEN);
-					update_cnt = SMILEY_EYE_DELAY;
-					CLEAR_FLAG(UPDATE_LEDS);
-				}
+/**
+ * Find the animation program of a chase sequence.
+ *
+ * @param chase	chase sequence (see ALL_CONSTANT)
+ * @return		program in flash, or NULL if the sequence isn't one
+ */
+static const uint8_t *find_animation(const uint8_t chase)
+{
+	switch (chase) {
+		case LOOP_ALL:		return ANIM_LOOP_ALL;
+		case ALL_WHITE:		return ANIM_ALL_WHITE;
+		case BINARY_ROWS:	return ANIM_BINARY_ROWS;
+		case BINARY_COLS:	return ANIM_BINARY_COLS;
+		case QUAD_WHEEL:	return ANIM_QUAD_WHEEL;
+		case QUAD_WHEEL2:	return ANIM_QUAD_WHEEL2;
+		case LOOP_QUAD:		return ANIM_LOOP_QUAD;
+		case SMILEY:		return ANIM_SMILEY;
+		case TEST_CORNERS:	return ANIM_TEST_CORNERS;
+		default:			return NULL;
+	}
+}
 
-				break;
+/**
+ * Copy a user program from EEPROM, so playing it never waits on EEPROM.
+ * A blank slot reads as 0xFF, which ends the program at once.
+ *
+ * @param slot	program slot [0, ANIM_SLOTS - 1]
+ * @return		the copy in RAM
+ */
+static const uint8_t *load_program(const uint8_t slot)
+{
+	eeprom_read_block(anim_cache, ee_programs[slot], ANIM_SLOT_SIZE);
+	return anim_cache;
+}
+
+/**
+ * Save part of a user program in EEPROM, from a REG_PROGRAM message.
+ * Takes 3.4 ms for each byte changed, while the LEDs are still shown
+ * and more messages are queued. The program restarts if it's playing.
+ *
+ * @param data	[slot, offset, program bytes...]
+ * @param len	bytes of data
+ */
+static void write_program(const volatile uint8_t *data, const uint8_t len)
+{
+	const uint8_t slot = data[0];
+	uint8_t offset = data[1];
+	uint8_t i = 0;
+
+	if (len < 3 || slot >= ANIM_SLOTS || offset >= ANIM_SLOT_SIZE ||
+		len - 2 > ANIM_SLOT_SIZE - offset)
+		return;
+
+	for (i = 2; i < len; ++i, ++offset) {
+		eeprom_update_byte(&ee_programs[slot][offset], data[i]);
+#ifdef HW_WATCHDOG
+		wdt_reset();
+#endif
+	}
+
+	if (chase_sequence == USER_PROGRAM + slot)
+		SET_FLAG(SET_LEDS);
+}
 
-			//-------------------------
-			// Set matrix to white
-			//-------------------------
-			case ALL_WHITE:
-				if (FLAG_IS_SET(SET_LEDS)) {
-					set_matrix(0, COL_WHITE);
-					CLEAR_FLAG(SET_LEDS);
+/**
+ * Run the animation program until its next ANIM_WAIT.
+ *
+ * @return	milliseconds until the next step
+ */
+static uint16_t play_animation(void)
+{
+	uint8_t ops = 0;
+	uint8_t op = 0;
+	uint8_t at = 0;
+	uint8_t to = 0;
+	uint8_t color = 0;
+	uint8_t mtrx = 0;
+
+	while (++ops != ANIM_MAX_OPS) {
+		op = ANIM_FETCH();
+
+		switch (op) {
+			case ANIM_PIXEL:
+			case ANIM_RECT:
+			case ANIM_QUAD:
+			case ANIM_COUNT_ROWS:
+			case ANIM_COUNT_COLS:
+				at = ANIM_FETCH();
+				to = (op == ANIM_RECT) ? ANIM_FETCH() : at;
+				color = anim_color(ANIM_FETCH());
+				for (mtrx = 0; mtrx < MATRICES; ++mtrx) {
+					if (at & ANIM_MATRIX(mtrx))
+						anim_draw(op, mtrx, at, to, color);
 				}
+				if (op == ANIM_COUNT_ROWS || op == ANIM_COUNT_COLS)
+					++anim.count;
 				break;
-
-			//-------------------------
-			// Turn off all LEDs
-			//-------------------------
-			case ALL_OFF:
-			default:
-				if (FLAG_IS_SET(SET_LEDS)) {
-					turn_off_matrices();
-					CLEAR_FLAG(SET_LEDS);
+			case ANIM_QUADS:
+				set_quadrants(anim_color(ANIM_FETCH()));
+				break;
+			case ANIM_WAIT:
+				return (uint16_t)ANIM_FETCH() * ANIM_TICK;
+			case ANIM_MARK:
+				anim.mark = anim.pc;
+				anim.loops = 0;
+				break;
+			case ANIM_LOOP:
+				at = ANIM_FETCH();
+				if (at == ANIM_FOREVER) {
+					anim.pc = anim.mark;
+				}
+				else {
+					if (anim.loops == 0)
+						anim.loops = at;
+					if (--anim.loops != 0)
+						anim.pc = anim.mark;
 				}
 				break;
-			
-			//-------------------------
-			// Test - Test corner LEDs
-			//-------------------------
-			case TEST_CORNERS:
-				set_led(0, 7, 0, COL_BLACK);
-				set_led(0, 0, 0, COL_RED);
-				set_led(0, 4, 4, COL_RED);
-				set_led(1, 7, 7, COL_BLACK);
-				set_led(1, 0, 7, COL_RED);
-				set_led(1, 4, 3, COL_RED);
-				_delay_ms(200);
-				set_led(0, 0, 0, COL_BLACK);
-				set_led(0, 0, 7, COL_BLUE);
-				set_led(0, 4, 4, COL_BLUE);
-				set_led(1, 0, 7, COL_BLACK);
-				set_led(1, 0, 0, COL_BLUE);
-				set_led(1, 4, 3, COL_BLUE);
-				_delay_ms(200);
-				set_led(0, 0, 7, COL_BLACK);
-				set_led(0, 7, 7, COL_YELLOW);
-				set_led(0, 4, 4, COL_YELLOW);
-				set_led(1, 0, 0, COL_BLACK);
-				set_led(1, 7, 0, COL_YELLOW);
-				set_led(1, 4, 3, COL_YELLOW);
-				_delay_ms(200);
-				set_led(0, 7, 7, COL_BLACK);
-				set_led(0, 7, 0, COL_GREEN);
-				set_led(0, 4, 4, COL_GREEN);
-				set_led(1, 7, 0, COL_BLACK);
-				set_led(1, 7, 7, COL_GREEN);
-				set_led(1, 4, 3, COL_GREEN);
-				_delay_ms(200);
+			case ANIM_COLOR:
+				anim.color = step_color(anim.color, (int8_t)ANIM_FETCH());
 				break;
+			case ANIM_END:
+			default:
+				--anim.pc;	// Stay here
+				return CHASE_IDLE_TIME;
 		}
+	}
+	return CHASE_IDLE_TIME;		// No ANIM_WAIT yet, go on next time
+}
 
-		//-------------------------
-		// Update Timer - 10ms increments
-		//-------------------------
-		if (update_cnt > 0) {
-			_delay_ms(10);
-			if (--update_cnt == 0) {
-				SET_FLAG(UPDATE_LEDS);
+/**
+ * Draw an animation op on one matrix.
+ *
+ * @param op	ANIM_PIXEL, ANIM_RECT, ANIM_QUAD, ANIM_COUNT_ROWS or ANIM_COUNT_COLS
+ * @param mtrx	matrix [0, 1]
+ * @param at	first row & column (see ANIM_AT)
+ * @param to	last row & column, for ANIM_RECT
+ * @param color	color to draw
+ */
+static void anim_draw(const uint8_t op, const uint8_t mtrx, const uint8_t at, const uint8_t to, const uint8_t color)
+{
+	uint8_t row = 0;
+	uint8_t col = 0;
+
+	switch (op) {
+		case ANIM_RECT:
+			for (row = ANIM_ROW(at); row <= ANIM_ROW(to); ++row) {
+				for (col = ANIM_COL(at); col <= ANIM_COL(to); ++col)
+					set_led(mtrx, row, col, color);
 			}
-		}
+			break;
+		case ANIM_QUAD:
+			set_quadrant(mtrx, ANIM_COL(at) & (QUADS - 1), color);
+			break;
+		case ANIM_COUNT_ROWS:
+			for (row = 0; row < ROWS; ++row)
+				set_row(mtrx, row, (anim.count & _BV(row)) ? color : COL_BLACK);
+			break;
+		case ANIM_COUNT_COLS:
+			for (col = 0; col < COLUMNS; ++col)
+				set_column(mtrx, col, (anim.count & _BV(col)) ? color : COL_BLACK);
+			break;
+		case ANIM_PIXEL:
+		default:
+			set_led(mtrx, ANIM_ROW(at), ANIM_COL(at), color);
+			break;
+	}
+}
 
+/**
+ * Get the color an animation op draws with.
+ *
+ * @param color	color operand, or ANIM_COLOR_REG
+ * @return		a color that can be shown
+ */
+static uint8_t anim_color(const uint8_t color)
+{
+	if (color == ANIM_COLOR_REG)
+		return (anim.color < UNIQUE_COLORS) ? anim.color : COL_BLACK;
+	return IS_PIXEL(color) ? color : COL_BLACK;
+}
 
-		//-------------------------
-		// WatchDog Timer
-		//-------------------------
-		if (wdt_cnt < WDT_MAX) {
-			if (++wdt_cnt == WDT_MAX) {
-				DISABLE_SERVOS();
-				SET_FLAG(SET_LEDS);
-				SET_FLAG(PASSIVE_MODE);
-				chase_sequence = SMILEY;
-			}
-		}
-		
+/**
+ * Step through the colors, skipping black.
+ *
+ * @param color	color [1, UNIQUE_COLORS - 1]
+ * @param step	colors to move, up or down
+ * @return		next color, wrapped around
+ */
+static uint8_t step_color(const uint8_t color, const int8_t step)
+{
+	int16_t next = (int16_t)color + step;
 
-	}	// End of Main Loop
-}	// End of Main
+	while (next < 1)
+		next += UNIQUE_COLORS - 1;
+	while (next >= UNIQUE_COLORS)
+		next -= UNIQUE_COLORS - 1;
+	return (uint8_t)next;
+}
+
+/**
+ * Read the millisecond tick, which Timer2 may change mid read.
+ *
+ * @return	milliseconds since reset (wraps)
+ */
+static inline uint16_t read_ticks(void)
+{
+	uint16_t now;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		now = ticks;
+	}
+	return now;
+}
 
 /**************************************************************************
 	UTILITIES
@@ -455,7 +737,10 @@ int main (void)
  */
 static void set_led(const uint8_t mtrx, const uint8_t row, const uint8_t col, const uint8_t color)
 {
+	if (colors[mtrx][col][row] == color)
+		return;
 	colors[mtrx][col][row] = color;
+	mark_columns(_BV(col));
 }
 
 /**
@@ -471,6 +756,7 @@ static void turn_off_matrices(void)
 			colors[1][col][led] = COL_BLACK;
 		}
 	}
+	mark_columns(ALL_COLUMNS);
 }
 
 /**
@@ -487,6 +773,7 @@ static void set_matrix(const uint8_t mtrx, const uint8_t color)
 			colors[mtrx][col][led] = color;
 		}
 	}
+	mark_columns(ALL_COLUMNS);
 }
 
 /**
@@ -500,6 +787,7 @@ static void set_column(const uint8_t mtrx, const uint8_t col, const uint8_t colo
 	uint8_t led = 0;
 	for (led = 0; led < LEDS; ++led)
 		colors[mtrx][col][led] = color;
+	mark_columns(_BV(col));
 }
 
 /**
@@ -513,6 +801,7 @@ static void set_row(const uint8_t mtrx, const uint8_t row, const uint8_t color)
 	uint8_t col = 0;
 	for (col = 0; col < COLUMNS; ++col)
 		colors[mtrx][col][row] = color;
+	mark_columns(ALL_COLUMNS);
 }
 
 /**
@@ -576,6 +865,7 @@ static void set_quadrants(const uint8_t color)
 			colors[1][col][7] = color;
 		}
 	}
+	mark_columns(ALL_COLUMNS);
 }
 
 /**
@@ -588,6 +878,7 @@ static void set_quadrant(const uint8_t mtrx, const uint8_t quad, const uint8_t c
 {
 	uint8_t col = 0;
 	uint8_t led = 0;
+	uint8_t cols = 0;
 
 	switch (mtrx) {
 
@@ -597,46 +888,55 @@ static void set_quadrant(const uint8_t mtrx, const uint8_t quad, const uint8_t c
 				for (col = 4; col < COLUMNS; ++col)
 					for (led = 0; led < 4; ++led)
 						colors[0][col][led] = color;
+				cols |= RIGHT_COLUMNS;
 				break;
 			case (1):
 				for (col = 0; col < 4; ++col)
 					for (led = 0; led < 4; ++led)
 						colors[0][col][led] = color;
+				cols |= LEFT_COLUMNS;
 				break;
 			case (2):
 				for (col = 0; col < 4; ++col)
 					for (led = 4; led < LEDS; ++led)
 						colors[0][col][led] = color;
+				cols |= LEFT_COLUMNS;
 				break;
 			case (3):
 				for (col = 4; col < COLUMNS; ++col)
 					for (led = 4; led < LEDS; ++led)
 						colors[0][col][led] = color;
+				cols |= RIGHT_COLUMNS;
 				break;
 			default:
 				break;
 		}
+		break;
 	case (1):
 		switch (quad) {
 			case (0):
 				for (col = 0; col < 4; ++col)
 					for (led = 0; led < 4; ++led)
 						colors[1][col][led] = color;
+				cols |= LEFT_COLUMNS;
 				break;
 			case (1):
 				for (col = 4; col < COLUMNS; ++col)
 					for (led = 0; led < 4; ++led)
 						colors[1][col][led] = color;
+				cols |= RIGHT_COLUMNS;
 				break;
 			case (2):
 				for (col = 4; col < COLUMNS; ++col)
 					for (led = 4; led < LEDS; ++led)
 						colors[1][col][led] = color;
+				cols |= RIGHT_COLUMNS;
 				break;
 			case (3):
 				for (col = 0; col < 4; ++col)
 					for (led = 4; led < LEDS; ++led)
 						colors[1][col][led] = color;
+				cols |= LEFT_COLUMNS;
 				break;
 			default:
 				break;
@@ -646,125 +946,1358 @@ static void set_quadrant(const uint8_t mtrx, const uint8_t quad, const uint8_t c
 		break;
 
 	}
+	mark_columns(cols);
 }
 
-/**************************************************************************
-	INTERRUPT HANDLERS
-***************************************************************************/
-// Catch-All Default for Unexpected Interrupts
-//ISR(BADISR_vect){}
-
-/***************************************************************
- * TWI Interrupt Service Routine - Communication with PubNub Client
+/**
+ * Mark columns as changed, to be encoded again into both LED buffers.
  *
- *	This ISR will control the communication between this chip 
- *	and the PubNub client. The client is acts as the bus master
- *	and controls the coloration of the matrices.
- ***************************************************************/
-ISR(TWI_vect)
+ * @param cols	1 bit for each column of the matrices
+ */
+static void mark_columns(const uint8_t cols)
 {
-	switch (TWSR)
-	{
-		//--------------------------------------
-		// Receive Data
-		//--------------------------------------
-
-		// Received: SLA + W; ACK returned
-		case TWI_SRX_ADR_ACK:
-			TWI_isBusy = true;
-			TWI_ENABLE_ACK();
-			break;
-
-		// Received: Data after SLA+W; ACK returned
-		case TWI_SRX_ADR_DATA_ACK:
-		// Received: Data after SLA+W; NACK returned
-		case TWI_SRX_ADR_DATA_NACK:
-			TWI_msgBuf = TWDR;
-			TWI_ENABLE_ACK();
-			break;
+	dirty_columns[0] |= cols;
+	dirty_columns[1] |= cols;
+#ifdef DITHER_RGB
+	dither_dirty[0] &= ~cols;
+	dither_dirty[1] &= ~cols;
+#endif
+}
 
-		//--------------------------------------
-		// STOP or Repeated START
-		//--------------------------------------
-		case TWI_SRX_STOP_RESTART:
-			SET_FLAG(RESET_CHASE);
-			quad_flags = TWI_msgBuf;
-			TWI_isBusy = false;
-			TWI_ENABLE_ACK();
-			break;
+/**
+ * Expand the levels of a color into its SDI port bits for every bit
+ * plane. In linear mode, plane N is set while the level is above N.
+ * In BAM mode, plane N is bit N of the level. The bits are set for
+ * both matrices (SDI_MASK0 and SDI_MASK1 << SDI_SHIFT1), and
+ * render_column keeps the ones of each matrix.
+ *
+ * @param red, green, blue	levels [0, COLOR_MAX_RESOLUTION]
+ * @param planes			SDI port bits of each bit plane
+ */
+static void expand_levels(const uint8_t red, const uint8_t green, const uint8_t blue, uint8_t planes[COLOR_PLANES])
+{
+	uint8_t plane = 0;
+	uint8_t sdi = 0;
+
+	for (plane = 0; plane < COLOR_PLANES; ++plane) {
+		sdi = 0;
+		if (LED_IS_ON(red, plane))		sdi |= SDI_R0 | (SDI_R1 << SDI_SHIFT1);
+		if (LED_IS_ON(green, plane))	sdi |= SDI_G0 | (SDI_G1 << SDI_SHIFT1);
+		if (LED_IS_ON(blue, plane))		sdi |= SDI_B0 | (SDI_B1 << SDI_SHIFT1);
+		planes[plane] = sdi;
+	}
+}
 
-		//--------------------------------------
-		// Transmit Data
-		//--------------------------------------
+/**
+ * Expand one palette color into palette_planes: the uploaded levels
+ * if there are any, otherwise the built-in COLOR_LEVELS, or black.
+ *
+ * @param color	palette color [0, PALETTE_COLORS - 1]
+ */
+static void load_color(const uint8_t color)
+{
+	uint8_t rgb[RGB_LEVELS] = {0, 0, 0};
+	uint8_t i = 0;
 
-		// Received: SLA + R; ACK returned
-		case TWI_STX_ADR_ACK:
-		// Transmitted TWDR; ACK received, Done
-		case TWI_STX_DATA_ACK_LAST_BYTE:
-		// Transmitted TWDR; ACK received
-		case TWI_STX_DATA_ACK:          
-		// Transmitted TWDR; NACK received
-		case TWI_STX_DATA_NACK:  
+	if (!(eeprom_read_byte(&ee_palette_set[color >> 3]) & PALETTE_BIT(color))) {
+		eeprom_read_block(rgb, ee_palette[color], RGB_LEVELS);
+		for (i = 0; i < RGB_LEVELS; ++i)
+			rgb[i] >>= 8 - COLOR_DEPTH;
+	}
+	else if (color < UNIQUE_COLORS) {
+		for (i = 0; i < RGB_LEVELS; ++i)
+			rgb[i] = PALETTE_TO_LEVEL(pgm_read_byte(&COLOR_LEVELS[color][i]));
+	}
 
-		//--------------------------------------
-		// General Call
-		//--------------------------------------
+	expand_levels(rgb[RED_LEVEL], rgb[GREEN_LEVEL], rgb[BLUE_LEVEL], palette_planes[color]);
+}
 
-		// Received: General Call; ACK returned
-		case TWI_SRX_GEN_ACK:
-		// Received: Data after Gen Call; ACK returned
-		case TWI_SRX_GEN_DATA_ACK:
-		// Received: Data after Gen Call; NACK returned
-		case TWI_SRX_GEN_DATA_NACK:
+/**
+ * Expand every palette color, at power up.
+ */
+static void load_palette(void)
+{
+	uint8_t color = 0;
 
-		//--------------------------------------
-		// Error States
-		//--------------------------------------
+	for (color = 0; color < PALETTE_COLORS; ++color)
+		load_color(color);
+}
 
-		// Bus Error: Illegal START or STOP
-		case TWI_BUS_ERROR:
-		// And anything else...
-		default:     
-			TWI_isBusy = false;
-			TWI_RECOVER();
-			TWI_ENABLE_ACK();
+/**
+ * Save palette colors in EEPROM, from a REG_PALETTE message, and show
+ * them at once. Takes 3.4 ms for each byte changed, while the LEDs are
+ * still shown (see write_program). Colors past the palette are ignored.
+ *
+ * @param data	[first color, red, green, blue, ...], or [first color]
+ *				alone to restore the built-in colors from there on
+ * @param len	bytes of data
+ */
+static void write_palette(const volatile uint8_t *data, const uint8_t len)
+{
+	uint8_t color = data[0];
+	uint8_t set = 0;
+	uint8_t i = 1;
+	uint8_t level = 0;
+
+	for (; color < PALETTE_COLORS; ++color) {
+		set = eeprom_read_byte(&ee_palette_set[color >> 3]);
+		if (len == 1) {
+			set |= PALETTE_BIT(color);
+		}
+		else if (len - i >= RGB_LEVELS) {
+			for (level = 0; level < RGB_LEVELS; ++level, ++i)
+				eeprom_update_byte(&ee_palette[color][level], data[i]);
+			set &= ~PALETTE_BIT(color);
+		}
+		else {
 			break;
+		}
+		eeprom_update_byte(&ee_palette_set[color >> 3], set);
+		load_color(color);
+#ifdef HW_WATCHDOG
+		wdt_reset();
+#endif
 	}
+
+	mark_columns(ALL_COLUMNS);
 }
 
-/***************************************************************
- * Timer/Counter0 Compare Match A
+/**
+ * Encode one column of both matrices for the refresh ISR.
  *
- * This ISR is the core timing mechanism of the LED control.
- * It fires at every possible LED turn off time. A count of 
- * zero signifies the start of a new RGB period. At all counts
- * after that, the turn off times for each LED are compared 
- * to the current time. If they are equal an LED is turned off.
+ * Each R, G, & B LED gets one bit per bit plane, packed in shift
+ * order (LED 7 first), one byte per clock, laid out as the SDI pins
+ * of both ports (see SDI_SHIFT1). Palette colors were expanded when
+ * loaded (see palette_planes), so only direct pixels are expanded
+ * here. This keeps the palette and level compares out of
+ * TIMER0_COMPA_vect, which then only has to write each port once
+ * per clock.
  *
- * In this way, the code is simulating a PWM channel for every
- * R, G, & B LED in two entire matrices (2 x 8 x 8 x 3 total LEDs).
- * The max resolution for the LEDs is set in color_8bit.h.
- ***************************************************************/
-ISR(TIMER0_COMPA_vect)
+ * @param planes	bit planes of the column in the back buffer
+ * @param col		column of the matrix [0, 7]
+ */
+static void render_column(uint8_t planes[COLOR_PLANES][LEDS], const uint8_t col)
 {
-	uint8_t data_red0 = 0;
-	uint8_t data_green0 = 0;
-	uint8_t data_blue0 = 0;
-	uint8_t data_red1 = 0;
-	uint8_t data_green1 = 0;
-	uint8_t data_blue1 = 0;
-	uint8_t this_color = 0;
-	uint8_t bit = 8;
-	uint8_t led = 7;
+	uint8_t mtrx = 0;
+	uint8_t led = 0;
+	uint8_t plane = 0;
+	uint8_t pixel = 0;
+	uint8_t direct[MATRICES][COLOR_PLANES];		// Planes of direct pixels
+	const uint8_t *sdi[MATRICES];				// Planes of each pixel
+#ifdef DITHER_RGB
+	const uint8_t *level;						// Of a PIXEL_DITHER pixel
+	uint8_t threshold = 0;
+	bool dithered = false;
+#endif
+
+	for (led = 0; led < LEDS; ++led) {
+#ifdef DITHER_RGB
+		threshold = pgm_read_byte(&DITHER_ORDER[(dither_phase + DITHER_OFFSET(led, col)) & DITHER_MASK]);
+#endif
+		for (mtrx = 0; mtrx < MATRICES; ++mtrx) {
+			pixel = colors[mtrx][col][led];
+#ifdef DITHER_RGB
+			if (pixel & PIXEL_DITHER) {
+				level = dither_levels[mtrx][col][led];
+				expand_levels(dither_level(level[RED_LEVEL], threshold), dither_level(level[GREEN_LEVEL], threshold),
+							  dither_level(level[BLUE_LEVEL], threshold), direct[mtrx]);
+				sdi[mtrx] = direct[mtrx];
+				dithered = true;
+			}
+			else
+#endif
+			if (pixel & PIXEL_DIRECT) {
+				expand_levels(PALETTE_TO_LEVEL(PIXEL_RED(pixel)), PALETTE_TO_LEVEL(PIXEL_GREEN(pixel)),
+							  PALETTE_TO_LEVEL(PIXEL_BLUE(pixel)), direct[mtrx]);
+				sdi[mtrx] = direct[mtrx];
+			}
+			else {
+				sdi[mtrx] = palette_planes[pixel];
+			}
+		}
+		for (plane = 0; plane < COLOR_PLANES; ++plane)
+			planes[plane][(LEDS - 1) - led] = (sdi[0][plane] & SDI_MASK0) |
+											  (sdi[1][plane] & (SDI_MASK1 << SDI_SHIFT1));
+	}
+
+#ifdef DITHER_RGB
+	if (dithered)
+		dither_columns |= _BV(col);
+	else
+		dither_columns &= ~_BV(col);
+#endif
+}
+
+#ifdef DITHER_RGB
+/**
+ * LED level of a dithered level in this frame.
+ *
+ * @param level		LED level with DITHER_BITS of fraction
+ * @param threshold	DITHER_ORDER of the pixel in this frame
+ * @return			level [0, COLOR_MAX_RESOLUTION]
+ */
+static inline uint8_t dither_level(const uint8_t level, const uint8_t threshold)
+{
+	return (level >> DITHER_BITS) + ((level & DITHER_MASK) > threshold);
+}
+
+/**
+ * Step the dither of PIXEL_DITHER pixels to the next frame, once the
+ * back buffer is free, so every frame shown is one step. Only their
+ * columns are encoded again. With REG_SYNC on, this steps with every
+ * GC_LATCH. Columns changed by nothing else are kept in dither_dirty,
+ * so STATUS_LATCHED stays set.
+ */
+static void step_dither(void)
+{
+	if (dither_columns == 0 || SWAP_IS_PENDING || FLAG_IS_SET(FRAME_READY))
+		return;
+
+	++dither_phase;
+	dither_dirty[0] |= dither_columns & ~dirty_columns[0];
+	dither_dirty[1] |= dither_columns & ~dirty_columns[1];
+	dirty_columns[0] |= dither_columns;
+	dirty_columns[1] |= dither_columns;
+}
+#endif
+
+/**
+ * Show the colors set since the last call.
+ *
+ * Changed columns are encoded into the back buffer, which the ISR
+ * swaps in when it wraps to column 0, so a frame is never shown half
+ * drawn. Until the previous swap, the back buffer is still waiting to
+ * be shown, so changes are kept for the next call instead of waiting.
+ * Then the main loop never stalls on a swap (see step_dither).
+ *
+ * With REG_SYNC on, the swap waits for a GC_LATCH from the bus master
+ * instead. Until then the back buffer is left alone, and changes are
+ * kept for the next frame.
+ */
+static void show_matrices(void)
+{
+	uint8_t front = 0;
+	uint8_t back = 0;
+	uint8_t col = 0;
+
+	if (SWAP_IS_PENDING || FLAG_IS_SET(FRAME_READY))
+		return;
+	front = (leds_front == leds[0]) ? 0 : 1;
+	back = front ^ 1;
+
+	// Nothing changed since the front buffer was encoded
+	if (dirty_columns[front] == 0)
+		return;
+
+	for (col = 0; col < COLUMNS; ++col) {
+		if (dirty_columns[back] & _BV(col))
+			render_column(leds[back][col], col);
+	}
+
+	dirty_columns[back] = 0;
+#ifdef DITHER_RGB
+	dither_dirty[back] = 0;
+#endif
+	if (SYNC_IS_ON)
+		SET_FLAG(FRAME_READY);
+	else
+		REQUEST_SWAP();
+}
+
+/**************************************************************************
+	TWI MESSAGES
+***************************************************************************/
+
+/**
+ * Queue a command for the main loop, called by TWI_vect only.
+ * There is always room: a message is NACKed at SLA+W while the ring
+ * is full, and a register message once its last free slot is taken,
+ * so a stream or one byte message finds the slot it was ACKed for.
+ *
+ * @param cmd	command to run (see run_command)
+ */
+static inline void queue_command(const command_t *cmd)
+{
+	const uint8_t head = cmd_head;
+
+	cmd_ring[head] = *cmd;
+	cmd_head = NEXT_COMMAND(head);
+}
+
+/**
+ * Flow control bits for the bus master, called by TWI_vect only.
+ *
+ * @return	READ_STATUS (see STATUS_STREAM_FREE)
+ */
+static inline uint8_t read_status(void)
+{
+	const uint8_t front = (leds_front == leds[0]) ? 0 : 1;
+#ifdef DITHER_RGB
+	const uint8_t changed = dirty_columns[front] & ~dither_dirty[front];
+#else
+	const uint8_t changed = dirty_columns[front];
+#endif
+	uint8_t status = 0;
+
+	if (TWI_NOT_DONE)
+		status |= STATUS_STREAM_FREE;
+	if (!COMMANDS_WAITING)
+		status |= STATUS_QUEUE_EMPTY;
+	// A frame waiting to be swapped in (or for GC_LATCH) leaves its columns
+	// dirty in the front buffer, so the swap needn't be checked. Columns only
+	// a dither step changed don't count, the front buffer has every color.
+	if (status == (STATUS_STREAM_FREE | STATUS_QUEUE_EMPTY) && changed == 0)
+		status |= STATUS_LATCHED;
+	if (FLAG_IS_SET(PASSIVE_MODE))
+		status |= STATUS_PASSIVE;
+	if (FLAG_IS_SET(FRAME_READY))
+		status |= STATUS_READY;
+	if (SYNC_IS_ON)
+		status |= STATUS_SYNC;
+	if (FLAG_IS_SET(DIRECT_MODE))
+		status |= STATUS_DIRECT;
+	if (FLAG_IS_SET(SAVE_REFUSED))
+		status |= STATUS_NOT_SAVED;
+	return status;
+}
+
+/**
+ * Run every command queued by TWI_vect, in the order received.
+ *
+ * @return	true if there were any
+ */
+static bool read_commands(void)
+{
+	uint8_t tail = cmd_tail;
+	command_t cmd;
+
+	if (tail == cmd_head)
+		return false;
+
+	do {
+		cmd = cmd_ring[tail];
+		run_command(&cmd);
+		tail = NEXT_COMMAND(tail);
+		cmd_tail = tail;	// Freed once run, for STATUS_QUEUE_EMPTY
+	} while (tail != cmd_head);
+
+	CLEAR_FLAG(PASSIVE_MODE);
+	ENABLE_SERVOS();
+	return true;
+}
+
+/**
+ * Run one command from the bus master.
+ *
+ * Messages are [register, data, data, ...], each data byte for that
+ * register and the ones after it (see REG_CHASE), and TWI_vect queues
+ * a command for the writes that do something (see write_register).
+ * Stream messages (REG_FRAME and after) are all data for one register,
+ * and are queued once they end, with the number of bytes in
+ * TWI_streamBuf. Frames are only shown if every byte was received. A
+ * message of one byte sets the quadrant flags and restarts the
+ * quadrant loop, as older bus masters expect.
+ *
+ * @param cmd	command queued by TWI_vect
+ */
+static void run_command(const command_t *cmd)
+{
+	switch (cmd->reg) {
+		case CMD_QUADS:
+			quad_flags = cmd->data;
+			chase_sequence = LOOP_QUAD;
+			break;
+		default:
+			if (cmd->reg < REG_FRAME) {
+				run_register(cmd);
+			}
+			else {
+				run_stream(cmd->reg, TWI_streamBuf, cmd->data);
+				CLEAR_FLAG(TWI_DONE);	// Done with TWI_streamBuf
+			}
+			break;
+	}
+}
+
+#ifdef UART_LINK
+/**
+ * Run the last packet from the USART, if there is one, and answer it.
+ * The message is run as if it came over TWI (see run_command). A
+ * packet that lost a byte (UART_LOST) is only answered, with UART_NAK.
+ *
+ * @return	true if a message was run
+ */
+static bool read_uart(void)
+{
+	const uint8_t len = uart_len;
+	uint8_t reg = uart_buf[0];
+	uint8_t crc = 0;
+	uint8_t i = 0;
+	bool good = false;
+	command_t cmd;
+
+	if (uart_state == UART_LOST) {
+		uart_state = UART_RESYNC;
+		LOOP_UNTIL_BV_HI(UCSR0A, UDRE0);
+		UDR0 = UART_NAK;
+		return false;
+	}
+	if (uart_state != UART_FULL)
+		return false;
+
+	crc = _crc8_ccitt_update(crc, len);
+	for (i = 0; i < len; ++i)
+		crc = _crc8_ccitt_update(crc, uart_buf[i]);
+
+	good = (crc == uart_crc);
+	if (good) {
+		if (len == 1) {
+			cmd.reg = CMD_QUADS;
+			cmd.data = reg;
+			run_command(&cmd);
+		}
+		else if (reg >= REG_FRAME) {
+			run_stream(reg, &uart_buf[1], len - 1);
+		}
+		else {
+			for (i = 1; i < len; ++i) {
+				if (write_register(reg++, uart_buf[i], &cmd))
+					run_register(&cmd);
+			}
+		}
+	}
+
+	// Take the next packet, then answer
+	uart_state = UART_WAIT_SYNC;
+	LOOP_UNTIL_BV_HI(UCSR0A, UDRE0);
+	UDR0 = good ? UART_ACK : UART_NAK;
+
+	if (!good)
+		return false;
+	CLEAR_FLAG(PASSIVE_MODE);
+	ENABLE_SERVOS();
+	return true;
+}
+#endif	// UART_LINK
+
+/**
+ * Run a stream message, from TWI or USART. Frames are only shown if
+ * every byte was received.
+ *
+ * @param reg	stream register (see REG_FRAME)
+ * @param data	data bytes of the message
+ * @param len	number of data bytes
+ */
+static void run_stream(const uint8_t reg, const volatile uint8_t *data, const uint8_t len)
+{
+	switch (reg) {
+		case REG_FRAME:
+			if (len == FRAME_BYTES)
+				read_frame(data);
+			break;
+		case REG_RUNS:
+			read_runs(data, len);
+			break;
+		case REG_DELTAS:
+			read_deltas(data, len);
+			break;
+		case REG_PROGRAM:
+			write_program(data, len);
+			break;
+		case REG_PALETTE:
+			write_palette(data, len);
+			break;
+#ifdef DITHER_RGB
+		case REG_RGB:
+			read_rgb(data, len);
+			break;
+#endif
+		default:
+			break;
+	}
+}
+
+/**
+ * Copy a received frame into the matrices, and stop the chase sequence.
+ * Unknown colors are shown as black. The whole frame is encoded by the
+ * next show_matrices(), so it is never shown half copied.
+ *
+ * @param data	FRAME_BYTES of packed colors
+ */
+static void read_frame(const volatile uint8_t *data)
+{
+	uint8_t *pixel = &colors[0][0][0];
+	uint8_t i = 0;
+
+	for (i = 0; i < FRAME_PIXELS / 4; ++i, data += 3, pixel += 4)
+		unpack_pixels(data[0], data[1], data[2], pixel, FLAG_IS_SET(DIRECT_MODE));
+
+	mark_columns(ALL_COLUMNS);
+	chase_sequence = ALL_CONSTANT;
+}
+
+/**
+ * Unpack 4 pixels of a frame (see FRAME_BYTES). Every 6 bit color is
+ * a palette color, so none are unknown.
+ *
+ * @param b0, b1, b2	packed bytes
+ * @param pixel			first of the 4 pixels in colors[][][]
+ * @param direct		direct pixels (see PIXEL_RGB), not palette colors
+ */
+static void unpack_pixels(const uint8_t b0, const uint8_t b1, const uint8_t b2, uint8_t *pixel, const bool direct)
+{
+	uint8_t packed[4];
+	uint8_t i = 0;
+
+	packed[0] = b0 & COLOR_MASK;
+	packed[1] = ((b0 >> 6) | (b1 << 2)) & COLOR_MASK;
+	packed[2] = ((b1 >> 4) | (b2 << 4)) & COLOR_MASK;
+	packed[3] = b2 >> 2;
+
+	for (i = 0; i < 4; ++i)
+		pixel[i] = direct ? PIXEL_DIRECT | packed[i] : packed[i];
+}
+
+/**
+ * Turn a 6 bit color from the master into a pixel of colors[][][].
+ * With FORMAT_DIRECT it's 2 bits each of red, green & blue (see
+ * PIXEL_RGB), otherwise a palette color, and unknown colors are black.
+ *
+ * @param color		6 bit color
+ * @return			the pixel
+ */
+static inline uint8_t to_pixel(const uint8_t color)
+{
+	if (FLAG_IS_SET(DIRECT_MODE))
+		return PIXEL_DIRECT | (color & COLOR_MASK);
+	return (color < PALETTE_COLORS) ? color : COL_BLACK;
+}
+
+/**
+ * Show a saved frame, and stop the chase sequence. Like read_frame,
+ * the whole frame is shown at once, by the next show_matrices().
+ * The pixels are of the kind saved, whatever the REG_FORMAT is now.
+ * A slot never saved is black.
+ *
+ * @param slot	frame slot [0, FRAME_SLOTS - 1]
+ */
+static void show_slot(const uint8_t slot)
+{
+	const uint8_t *saved = ee_frames[slot];
+	uint8_t *pixel = &colors[0][0][0];
+	uint8_t packed[3];
+	uint8_t i = 0;
+	bool direct = false;
+
+	if (slot >= FRAME_SLOTS)
+		return;
+
+	direct = !(eeprom_read_byte(&ee_frames_direct) & _BV(slot));
+	for (i = 0; i < FRAME_PIXELS / 4; ++i, saved += 3, pixel += 4) {
+		eeprom_read_block(packed, saved, sizeof(packed));
+		unpack_pixels(~packed[0], ~packed[1], ~packed[2], pixel, direct);
+	}
+
+	mark_columns(ALL_COLUMNS);
+	chase_sequence = ALL_CONSTANT;
+}
+
+/**
+ * Save the frame shown in a slot. Takes 3.4 ms for each byte changed,
+ * up to 330 ms, while the LEDs are still shown (see write_program).
+ * Only the 6 color bits are saved, and whether the pixels are direct,
+ * so a frame of both palette and direct pixels, or with 8 bit colors
+ * (PIXEL_DITHER), is not saved and SAVE_REFUSED is set instead.
+ *
+ * @param slot	frame slot [0, FRAME_SLOTS - 1]
+ */
+static void save_slot(const uint8_t slot)
+{
+	uint8_t *saved = ee_frames[slot];
+	const uint8_t *pixel = &colors[0][0][0];
+	const uint8_t kind = pixel[0] & PIXEL_DIRECT;
+	uint8_t direct = 0;
+	uint8_t i = 0;
+
+	if (slot >= FRAME_SLOTS)
+		return;
+
+	for (i = 0; i < FRAME_PIXELS; ++i) {
+		if ((pixel[i] & ~COLOR_MASK) != kind) {
+			SET_FLAG(SAVE_REFUSED);
+			return;
+		}
+	}
+	CLEAR_FLAG(SAVE_REFUSED);
+
+	direct = eeprom_read_byte(&ee_frames_direct);
+	eeprom_update_byte(&ee_frames_direct, kind ? direct & ~_BV(slot) : direct | _BV(slot));
+
+	for (i = 0; i < FRAME_PIXELS / 4; ++i, pixel += 4) {
+		eeprom_update_byte(saved++, ~((pixel[0] & COLOR_MASK) | (pixel[1] << 6)));
+		eeprom_update_byte(saved++, ~(((pixel[1] & COLOR_MASK) >> 2) | (pixel[2] << 4)));
+		eeprom_update_byte(saved++, ~(((pixel[2] & COLOR_MASK) >> 4) | (pixel[3] << 2)));
+#ifdef HW_WATCHDOG
+		wdt_reset();
+#endif
+	}
+}
+
+/**
+ * Set runs of pixels from a received message, and stop the chase
+ * sequence. Each run is [count, color], starting at pixel 0. Runs of
+ * COLOR_SKIP leave the pixels as they are, so a run can start anywhere.
+ * Runs past the last pixel are cut short, unknown colors are black.
+ *
+ * @param data	runs received
+ * @param len	data bytes received
+ */
+static void read_runs(const volatile uint8_t *data, const uint8_t len)
+{
+	uint8_t *pixels = &colors[0][0][0];
+	uint8_t pixel = 0;
+	uint8_t count = 0;
+	uint8_t color = 0;
+	uint8_t cols = 0;
+	uint8_t i = 0;
+
+	for (i = 0; i + 1 < len && pixel < FRAME_PIXELS; i += 2) {
+		count = data[i];
+		color = data[i + 1];
+		if (count > FRAME_PIXELS - pixel)
+			count = FRAME_PIXELS - pixel;
+
+		if (color == COLOR_SKIP) {
+			pixel += count;
+			continue;
+		}
+		color = to_pixel(color);
+		for (; count > 0; --count, ++pixel) {
+			pixels[pixel] = color;
+			cols |= _BV(PIXEL_COLUMN(pixel));
+		}
+	}
+
+	mark_columns(cols);
+	chase_sequence = ALL_CONSTANT;
+}
+
+/**
+ * Set single pixels from a received message, and stop the chase
+ * sequence. Each change is [pixel, color], pixels past the last one
+ * are skipped and unknown colors are black.
+ *
+ * @param data	changes received
+ * @param len	data bytes received
+ */
+static void read_deltas(const volatile uint8_t *data, const uint8_t len)
+{
+	uint8_t *pixels = &colors[0][0][0];
+	uint8_t pixel = 0;
+	uint8_t color = 0;
+	uint8_t cols = 0;
+	uint8_t i = 0;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		pixel = data[i];
+		color = data[i + 1];
+		if (pixel >= FRAME_PIXELS)
+			continue;
+		pixels[pixel] = to_pixel(color);
+		cols |= _BV(PIXEL_COLUMN(pixel));
+	}
+
+	mark_columns(cols);
+	chase_sequence = ALL_CONSTANT;
+}
+
+#ifdef DITHER_RGB
+/**
+ * Set pixels to 8 bit colors, from a REG_RGB message, and stop the chase
+ * sequence. Levels are gamma corrected (see GAMMA_LEVELS), scaled to a
+ * duty and turned into LED levels with a fraction (see DITHER_TOP) here,
+ * once, so each dither step only compares them (see dither_level).
+ *
+ * @param data	[first pixel, red, green, blue, ...] levels [0, 255]
+ * @param len	bytes of data
+ */
+static void read_rgb(const volatile uint8_t *data, const uint8_t len)
+{
+	uint8_t *pixels = &colors[0][0][0];
+	uint8_t *levels = &dither_levels[0][0][0][0];
+	uint8_t pixel = data[0];
+	uint8_t cols = 0;
+	uint8_t i = 1;
+	uint8_t rgb = 0;
+	uint16_t duty = 0;
+	uint16_t scaled = 0;
+
+	for (; pixel < FRAME_PIXELS && len - i >= RGB_LEVELS; ++pixel) {
+		for (rgb = 0; rgb < RGB_LEVELS; ++rgb, ++i) {
+			// Duty in half dither steps, so the level is only rounded once
+			scaled = pgm_read_byte(&GAMMA_LEVELS[data[i]]) * (DITHER_DUTY_MAX << 1);
+			duty = (scaled + (scaled >> 8) + 0x80) >> 8;	// Rounded / 255
+			if (duty > (DITHER_TOP << 1))
+				levels[pixel * RGB_LEVELS + rgb] = DITHER_TOP + ((duty - (DITHER_TOP << 1) + 2) >> 2);	// Two periods up
+			else
+				levels[pixel * RGB_LEVELS + rgb] = (duty + 1) >> 1;
+		}
+		pixels[pixel] = PIXEL_DITHER;
+		cols |= _BV(PIXEL_COLUMN(pixel));
+	}
+
+	mark_columns(cols);
+	chase_sequence = ALL_CONSTANT;
+}
+#endif
+
+/**
+ * Write a TWI register, called by TWI_vect (or read_uart). Registers
+ * that only hold a value for others are kept in twi_regs. A write
+ * that does something becomes a command, with the values of the
+ * registers it uses, for run_register. Nothing is drawn if any of
+ * the drawing registers is out of range.
+ *
+ * @param reg	register (see REG_CHASE)
+ * @param data	value to write
+ * @param cmd	command for the write, if it does something
+ * @return		true if cmd was filled in
+ */
+static bool write_register(const uint8_t reg, const uint8_t data, command_t *cmd)
+{
+	bool unlocked = false;
+
+	if (reg >= TWI_REGISTERS)
+		return false;
+	twi_regs[reg] = data;
+	cmd->reg = reg;
+	cmd->data = data;
+
+	switch (reg) {
+		case REG_CHASE:
+		case REG_QUADS:
+		case REG_SYNC:
+		case REG_SLOT:
+		case REG_FORMAT:
+			return true;
+		case REG_DRAW:
+			if (data == DRAW_NONE || data > DRAW_OFF ||
+				twi_regs[REG_MATRIX] >= MATRICES || twi_regs[REG_ROW] >= ROWS ||
+				twi_regs[REG_COLUMN] >= COLUMNS || twi_regs[REG_QUAD] >= QUADS)
+				return false;
+			cmd->data = CMD_DRAW(data, twi_regs[REG_MATRIX], twi_regs[REG_QUAD]);
+			cmd->arg = twi_regs[REG_COLOR];
+			cmd->at = CMD_AT(twi_regs[REG_ROW], twi_regs[REG_COLUMN]);
+			return true;
+		case REG_ADDRESS:
+			unlocked = (twi_regs[REG_KEY] == ADDRESS_KEY);
+			twi_regs[REG_KEY] = 0;	// Unlock again for every change
+			return unlocked;
+		case REG_IDLE_HI:
+			cmd->arg = twi_regs[REG_IDLE];
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Run a register write, from write_register.
+ *
+ * @param cmd	register, value and the registers it uses
+ */
+static void run_register(const command_t *cmd)
+{
+	const uint8_t data = cmd->data;
+
+	switch (cmd->reg) {
+		case REG_CHASE:
+			chase_sequence = data;
+			SET_FLAG(SET_LEDS);
+			break;
+		case REG_QUADS:
+			quad_flags = data;
+			break;
+		case REG_DRAW:
+			draw(cmd);
+			break;
+		case REG_SYNC:
+			set_sync(data);
+			break;
+		case REG_ADDRESS:
+			set_address(data);
+			break;
+		case REG_IDLE_HI:
+			idle_timeout = cmd->arg | ((uint16_t)data << 8);
+			break;
+		case REG_SLOT:
+			if (data & FRAME_SAVE)
+				save_slot(data & ~FRAME_SAVE);
+			else
+				show_slot(data);
+			break;
+		case REG_FORMAT:
+			if (data == FORMAT_DIRECT)
+				SET_FLAG(DIRECT_MODE);
+			else
+				CLEAR_FLAG(DIRECT_MODE);
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * Read the slave address saved in EEPROM.
+ *
+ * @return	saved address, or TWI_SLAVE_ADDRESS if none (blank EEPROM)
+ */
+static uint8_t read_address(void)
+{
+	const uint8_t addr = eeprom_read_byte(&ee_twi_address);
+
+	if (addr < TWI_ADDRESS_MIN || addr > TWI_ADDRESS_MAX)
+		return TWI_SLAVE_ADDRESS;
+	return addr;
+}
+
+/**
+ * Answer to a new slave address from now on, and save it in EEPROM.
+ * Addresses reserved by I2C are ignored.
+ *
+ * @param addr	7 bit slave address
+ */
+static void set_address(const uint8_t addr)
+{
+	if (addr < TWI_ADDRESS_MIN || addr > TWI_ADDRESS_MAX)
+		return;
+	eeprom_update_byte(&ee_twi_address, addr);
+	TWAR = (addr << 1) | (TWAR & _BV(TWGCE));
+}
+
+/**
+ * Turn frame sync over the general call on or off. When off, a frame
+ * waiting for GC_LATCH is shown right away.
+ *
+ * @param on	true to wait for GC_LATCH
+ */
+static void set_sync(const bool on)
+{
+	if (on) {
+		TWAR |= _BV(TWGCE);
+		return;
+	}
+
+	TWAR &= ~_BV(TWGCE);
+	if (FLAG_IS_SET(FRAME_READY)) {
+		CLEAR_FLAG(FRAME_READY);
+		REQUEST_SWAP();
+	}
+}
+
+/**
+ * Draw with the color and position of a REG_DRAW command, and stop
+ * the chase sequence so it is not drawn over. Nothing is drawn if the
+ * color is not one of REG_FORMAT.
+ *
+ * @param cmd	REG_DRAW command (see CMD_DRAW)
+ */
+static void draw(const command_t *cmd)
+{
+	const uint8_t color = to_pixel(cmd->arg);
+	const uint8_t mtrx = CMD_MATRIX(cmd->data);
+	const uint8_t row = CMD_ROW(cmd->at);
+	const uint8_t col = CMD_COLUMN(cmd->at);
+	const uint8_t quad = CMD_QUAD(cmd->data);
+
+	if (FLAG_IS_CLEAR(DIRECT_MODE) && cmd->arg >= PALETTE_COLORS)
+		return;
+
+	switch (CMD_OP(cmd->data)) {
+		case DRAW_LED:
+			set_led(mtrx, row, col, color);
+			break;
+		case DRAW_ROW:
+			set_row(mtrx, row, color);
+			break;
+		case DRAW_COLUMN:
+			set_column(mtrx, col, color);
+			break;
+		case DRAW_QUAD:
+			set_quadrant(mtrx, quad, color);
+			break;
+		case DRAW_MATRIX:
+			set_matrix(mtrx, color);
+			break;
+		case DRAW_QUADS:
+			set_quadrants(color);
+			break;
+		case DRAW_OFF:
+			turn_off_matrices();
+			break;
+		case DRAW_NONE:
+		default:
+			return;
+	}
+	chase_sequence = ALL_CONSTANT;
+}
+
+#ifdef BENCHMARK
+/**************************************************************************
+	BENCHMARK
+***************************************************************************/
+
+/**
+ * Run every chase sequence for BENCH_WINDOWS seconds, and print the ISR
+ * statistics for each one on USART0. The simulator (or a serial
+ * terminal) shows them as a table, ending with a DONE line. Stops the
+ * CPU when done.
+ *
+ * simavr has no bus master, so the TWI ISR never runs here; read its
+ * ISR_STATS from the board instead (READ_STATS).
+ */
+static void benchmark(void)
+{
+	static uint8_t seq = 0;
+	isr_stats_t stats;
+
+	if (fps_windows < BENCH_WINDOWS)
+		return;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		stats = isr_stats;
+	}
+
+	bench_print(" ");
+	bench_print_hex(chase_sequence);
+	bench_print_u16(stats.timer0.min, 7);
+	bench_print_u16(stats.timer0.max, 7);
+	bench_print_u16(stats.timer0.avg, 7);
+	bench_print_u16(stats.fps, 6);
+	bench_print("\n");
+
+	if (++seq < sizeof(BENCH_SEQUENCES)) {
+		chase_sequence = BENCH_SEQUENCES[seq];
+		SET_FLAG(SET_LEDS);
+		reset_isr_stats();
+		return;
+	}
+
+	bench_print("BENCHMARK DONE\n");
+
+	// Sleeping with interrupts off ends the simulation
+	cli();
+#ifdef HW_WATCHDOG
+	wdt_disable();
+#endif
+	sleep_enable();
+	sleep_cpu();
+}
+
+/**
+ * Start new ISR statistics.
+ */
+static void reset_isr_stats(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		isr_stats.timer0.min = 0xFFFF;
+		isr_stats.timer0.max = 0;
+		isr_stats.twi.min = 0xFFFF;
+		isr_stats.twi.max = 0;
+		isr_stats.fps = 0;
+		fps_windows = 0;
+	}
+}
+
+/**
+ * Print a string on USART0.
+ */
+static void bench_print(const char *str)
+{
+	while (*str) {
+		LOOP_UNTIL_BV_HI(UCSR0A, UDRE0);
+		UDR0 = *str++;
+	}
+}
+
+/**
+ * Print a number on USART0, right aligned.
+ *
+ * @param num	number to print
+ * @param width	minimum number of characters
+ */
+static void bench_print_u16(uint16_t num, uint8_t width)
+{
+	char str[6];
+	uint8_t len = 0;
+
+	do {
+		str[len++] = '0' + (num % 10);
+		num /= 10;
+	} while (num > 0);
+
+	while (width-- > len)
+		bench_print(" ");
+	while (len > 0) {
+		LOOP_UNTIL_BV_HI(UCSR0A, UDRE0);
+		UDR0 = str[--len];
+	}
+}
+
+/**
+ * Print a byte on USART0 as 0xHH.
+ */
+static void bench_print_hex(const uint8_t num)
+{
+	const char str[] = {'0', 'x', HEX_DIGIT(num >> 4), HEX_DIGIT(num & 0x0F), NUL};
+	bench_print(str);
+}
+#endif	// BENCHMARK
+
+/**************************************************************************
+	INTERRUPT HANDLERS
+***************************************************************************/
+// Catch-All Default for Unexpected Interrupts
+//ISR(BADISR_vect){}
+
+/***************************************************************
+ * TWI Interrupt Service Routine - Communication with PubNub Client
+ *
+ *	This ISR will control the communication between this chip 
+ *	and the PubNub client. The client is acts as the bus master
+ *	and controls the coloration of the matrices.
+ ***************************************************************/
+ISR(TWI_vect)
+{
+	command_t cmd;
+#ifdef ISR_STATS
+	const uint16_t start = TCNT1;
+	uint8_t i = 0;
+#endif
+
+	switch (TWSR)
+	{
+		//--------------------------------------
+		// Receive Data
+		//--------------------------------------
+
+		// Received: SLA + W; ACK returned
+		case TWI_SRX_ADR_ACK:
+			TWI_isBusy = true;
+			TWI_rxLen = 0;
+			TWI_rxStream = false;
+			if (COMMANDS_FULL) {
+				// No slot for the message, NACK its register
+				if (cmd_overflows < 0xFF)
+					++cmd_overflows;
+				TWI_RESET();
+			}
+			else {
+				TWI_ENABLE_ACK();
+			}
+			break;
+
+		// Received: Data after SLA+W; ACK returned
+		case TWI_SRX_ADR_DATA_ACK:
+			// Stream data, kept short for the bus rate (see REG_FRAME)
+			if (TWI_rxStream) {
+				*TWI_rxPtr = TWDR;
+				if (++TWI_rxPtr < &TWI_streamBuf[STREAM_BYTES])
+					TWI_ENABLE_ACK();
+				else
+					TWI_RESET();	// Buffer full, NACK the next byte
+			}
+			// First byte is the register
+			else if (TWI_rxLen == 0) {
+				TWI_rxReg = TWDR;
+				TWI_rxLen = 1;
+				// Stream registers are REG_FRAME to REG_STREAM_LAST
+				if (TWI_rxReg < REG_FRAME || TWI_rxReg > REG_STREAM_LAST) {
+					TWI_ENABLE_ACK();
+				}
+				else if (TWI_NOT_DONE) {
+					TWI_rxStream = true;
+					TWI_rxPtr = TWI_streamBuf;
+					TWI_ENABLE_ACK();
+				}
+				else {
+					// Last stream not read yet, NACK the data
+					TWI_RESET();
+				}
+			}
+			else {
+				TWI_rxLen = TWI_MSG_SIZE;
+				if (TWI_rxReg >= TWI_REGISTERS) {
+					// No such register, ignored
+					TWI_ENABLE_ACK();
+				}
+				else if (TWI_rxReg == REG_READ) {
+					// Needed before the next SLA+R, not queued
+					TWI_readReg = TWDR;
+					++TWI_rxReg;
+					TWI_ENABLE_ACK();
+				}
+				else {
+					if (write_register(TWI_rxReg, TWDR, &cmd))
+						queue_command(&cmd);
+					++TWI_rxReg;
+					if (COMMANDS_FULL)
+						TWI_RESET();	// Last slot taken, NACK the rest
+					else
+						TWI_ENABLE_ACK();
+				}
+			}
+			break;
+
+		// Received: Data after SLA+W; NACK returned
+		case TWI_SRX_ADR_DATA_NACK:
+			// Not stored, the message ends here (and is not one byte)
+			if (TWI_rxLen == 1)
+				TWI_rxLen = TWI_MSG_SIZE;
+			// continue
+
+		//--------------------------------------
+		// STOP or Repeated START
+		//--------------------------------------
+		case TWI_SRX_STOP_RESTART:
+			// Publish the stream for the main loop
+			// (in the slot kept free since SLA+W)
+			if (TWI_rxStream && TWI_rxPtr != TWI_streamBuf) {
+				cmd.reg = TWI_rxReg;
+				cmd.data = TWI_rxPtr - TWI_streamBuf;
+				queue_command(&cmd);
+				SET_FLAG(TWI_DONE);
+			}
+			else if (TWI_rxLen == 1) {
+				cmd.reg = CMD_QUADS;
+				cmd.data = TWI_rxReg;
+				queue_command(&cmd);
+			}
+			TWI_rxLen = 0;
+			TWI_rxStream = false;
+			TWI_isBusy = false;
+			TWI_ENABLE_ACK();
+			break;
+
+		//--------------------------------------
+		// Transmit Data
+		//--------------------------------------
+		// Received: SLA + R; ACK returned
+		case TWI_STX_ADR_ACK:
+			// Send a consistent copy of the read registers
+			TWI_txBuf[READ_FW_VERSION] = FW_VERSION;
+			TWI_txBuf[READ_HW_VERSION] = HW_VERSION;
+			TWI_txBuf[READ_STATUS] = read_status();
+			TWI_txBuf[READ_CHASE] = chase_sequence;
+			TWI_txBuf[READ_QUEUE_FREE] = (cmd_tail - cmd_head - 1) & COMMAND_MASK;
+			TWI_txBuf[READ_OVERFLOWS] = cmd_overflows;
+			TWI_txBuf[READ_COLOR_DEPTH] = COLOR_DEPTH;
+			TWI_txBuf[READ_PWM_MODE] = PWM_MODE;
+#ifdef ISR_STATS
+			for (i = 0; i < sizeof(isr_stats_t); ++i)
+				TWI_txBuf[READ_STATS + i] = ((const uint8_t *)&isr_stats)[i];
+#endif
+			TWI_txIndex = TWI_readReg;
+			TWI_isBusy = true;
+			// continue
+
+		// Transmitted TWDR; ACK received
+		case TWI_STX_DATA_ACK:          
+			if (TWI_txIndex < sizeof(TWI_txBuf))
+				TWDR = TWI_txBuf[TWI_txIndex++];
+			else
+				TWDR = 0xFF;
+			TWI_ENABLE_ACK();
+			break;
+
+		// Transmitted TWDR; ACK received, Done
+		case TWI_STX_DATA_ACK_LAST_BYTE:
+		// Transmitted TWDR; NACK received
+		case TWI_STX_DATA_NACK:  
+#ifdef ISR_STATS
+			// Start a new min / max once they have been read
+			if (TWI_txIndex > READ_STATS) {
+				isr_stats.timer0.min = 0xFFFF;
+				isr_stats.timer0.max = 0;
+				isr_stats.twi.min = 0xFFFF;
+				isr_stats.twi.max = 0;
+			}
+#endif
+			TWI_isBusy = false;
+			TWI_ENABLE_ACK();
+			break;
+
+		//--------------------------------------
+		// General Call
+		//--------------------------------------
+
+		// Received: General Call; ACK returned
+		case TWI_SRX_GEN_ACK:
+			TWI_isBusy = true;
+			TWI_ENABLE_ACK();
+			break;
+
+		// Received: Data after Gen Call; ACK returned
+		case TWI_SRX_GEN_DATA_ACK:
+			// Show the waiting frame at the next column 0
+			if (TWDR == GC_LATCH && FLAG_IS_SET(FRAME_READY)) {
+				CLEAR_FLAG(FRAME_READY);
+				REQUEST_SWAP();
+			}
+			TWI_ENABLE_ACK();
+			break;
+
+		// Received: Data after Gen Call; NACK returned
+		case TWI_SRX_GEN_DATA_NACK:
+			TWI_isBusy = false;
+			TWI_ENABLE_ACK();
+			break;
+
+		//--------------------------------------
+		// Error States
+		//--------------------------------------
+
+		// Bus Error: Illegal START or STOP
+		case TWI_BUS_ERROR:
+		// And anything else...
+		default:     
+			TWI_isBusy = false;
+			TWI_RECOVER();
+			TWI_ENABLE_ACK();
+			break;
+	}
+
+#ifdef ISR_STATS
+	RECORD_ISR_TIME(isr_stats.twi, twi_sum, twi_cnt, start);
+#endif
+}
+
+#ifdef UART_LINK
+/***************************************************************
+ * USART Receive Complete - Messages over USART0 (UART_LINK)
+ *
+ *	Collects one packet (see UART_SYNC) for the main loop, which
+ *	checks the CRC. Bytes are dropped until it has been read, and
+ *	a framing error or overrun has the main loop NAK the packet.
+ ***************************************************************/
+ISR(USART_RX_vect)
+{
+	const uint8_t status = UCSR0A;
+	const uint8_t data = UDR0;
+
+	if (uart_state == UART_FULL || uart_state == UART_LOST)
+		return;
+
+	if (status & (_BV(FE0) | _BV(DOR0))) {
+		if (uart_state != UART_RESYNC)
+			uart_state = UART_LOST;
+		return;
+	}
+
+	switch (uart_state) {
+		case UART_WAIT_SYNC:
+		case UART_RESYNC:
+			if (data == UART_SYNC)
+				uart_state = UART_LENGTH;
+			break;
+		case UART_LENGTH:
+			if (data == 0 || data > UART_MSG_SIZE) {
+				uart_state = UART_WAIT_SYNC;
+			}
+			else {
+				uart_len = data;
+				uart_cnt = 0;
+				uart_state = UART_DATA;
+			}
+			break;
+		case UART_DATA:
+			uart_buf[uart_cnt] = data;
+			if (++uart_cnt == uart_len)
+				uart_state = UART_CRC;
+			break;
+		case UART_CRC:
+			uart_crc = data;
+			uart_state = UART_FULL;
+			break;
+		default:
+			break;
+	}
+}
+#endif	// UART_LINK
+
+/***************************************************************
+ * Timer/Counter2 Compare Match A - Millisecond tick
+ *
+ *	Has priority over the LED and TWI ISRs, but is only a few
+ *	cycles, so neither is held up for long.
+ ***************************************************************/
+ISR(TIMER2_COMPA_vect)
+{
+	++ticks;
+}
+
+/***************************************************************
+ * Timer/Counter0 Compare Match A
+ *
+ * This ISR is the core timing mechanism of the LED control.
+ * It fires at every possible LED turn off time. A count of 
+ * zero signifies the start of a new RGB period. At every count,
+ * the LED bits for that bit plane (already encoded by
+ * render_column) are shifted out to the current drivers.
+ *
+ * In linear mode (PWM_LINEAR), every period is the same length
+ * and LEDs are turned off once their level has passed. In bit
+ * angle modulation mode (PWM_BAM), each bit plane is held for a
+ * time weighted by its bit position, by changing OCR0A for every
+ * plane. That takes one interrupt per color bit, not per level.
+ *
+ * In this way, the code is simulating a PWM channel for every
+ * R, G, & B LED in two entire matrices (2 x 8 x 8 x 3 total LEDs).
+ * The max resolution for the LEDs is set in color_8bit.h.
+ ***************************************************************/
+ISR(TIMER0_COMPA_vect)
+{
+	const uint8_t *data;
+	uint8_t port0 = 0;
+	uint8_t port1 = 0;
+	uint8_t sdi = 0;
+	uint8_t bit = 8;
+#ifdef ISR_STATS
+	const uint16_t start = TCNT1;
+
+	// Timer1 overflows every 65536 cycles, far slower than this ISR
+	if (TIFR1 & _BV(TOV1)) {
+		TIFR1 = _BV(TOV1);
+		if (++timer1_ovf == STATS_WINDOW) {
+			isr_stats.fps = frame_cnt;
+			frame_cnt = 0;
+			timer1_ovf = 0;
+			++fps_windows;
+		}
+	}
+#endif
+
+#if PWM_MODE == PWM_BAM
+	// Hold this plane for a time weighted by its bit position.
+	// Set first, while TCNT0 is still below even the shortest period.
+	OCR0A = BAM_OCR(OCR0A_cnt);
+
+	// Unless this ISR was held up (by the TWI ISR) past it, then the
+	// match would only come after TCNT0 wraps at 255. Restart the count.
+	if (TCNT0 >= OCR0A)
+		TCNT0 = 0;
+#endif
 
 	switch (OCR0A_cnt) {
 
+#if PWM_MODE == PWM_LINEAR
 		//--------------------------
 		// Max Resolution, don't do anything!
 		// At this point, LEDs should stay on
 		//--------------------------
 		case MAX_COLOR_RESOLUTION:
 			break;
+#endif
 
 		//--------------------------
 		// Start of LED Period
@@ -775,51 +2308,27 @@ ISR(TIMER0_COMPA_vect)
 			if (++ column == 8) {
 				SET_DATA_HI();
 				column = 0;
+
+				// Start showing the next frame
+				if (FLAG_IS_SET(SWAP_LEDS)) {
+					leds_front = (leds_front == leds[0]) ? leds[1] : leds[0];
+					CLEAR_FLAG(SWAP_LEDS);
+#ifdef ISR_STATS
+					++frame_cnt;
+#endif
+				}
 			}
 			else {
 				SET_DATA_LO();
 			}
-			// Turn all LEDs back on
-			leds[0][column][RED_LEDS] = 0xFF;
-			leds[0][column][GREEN_LEDS] = 0xFF;
-			leds[0][column][BLUE_LEDS] = 0xFF;
-			leds[1][column][RED_LEDS] = 0xFF;
-			leds[1][column][GREEN_LEDS] = 0xFF;
-			leds[1][column][BLUE_LEDS] = 0xFF;
 			// continue
 
 		//--------------------------
 		// All Other times
-		//	- Loop through all colors for all leds
-		//	- Turn individual LEDs off at the right time
+		//	- Shift out the LED bits for this bit plane
 		//--------------------------
 		default:
-			// Find LEDs to turn off
-			do {
-				// Matrix 0
-				this_color = colors[0][column][led];
-				if (OCR0A_cnt == COLOR_LEVELS[this_color][RED_LEVEL])
-					leds[0][column][RED_LEDS] &= ~(_BV(led));
-				if (OCR0A_cnt == COLOR_LEVELS[this_color][GREEN_LEVEL])
-					leds[0][column][GREEN_LEDS] &= ~(_BV(led));
-				if (OCR0A_cnt == COLOR_LEVELS[this_color][BLUE_LEVEL])
-					leds[0][column][BLUE_LEDS] &= ~(_BV(led));
-				// Matrix 1
-				this_color = colors[1][column][led];
-				if (OCR0A_cnt == COLOR_LEVELS[this_color][RED_LEVEL])
-					leds[1][column][RED_LEDS] &= ~(_BV(led));
-				if (OCR0A_cnt == COLOR_LEVELS[this_color][GREEN_LEVEL])
-					leds[1][column][GREEN_LEDS] &= ~(_BV(led));
-				if (OCR0A_cnt == COLOR_LEVELS[this_color][BLUE_LEVEL])
-					leds[1][column][BLUE_LEDS] &= ~(_BV(led));
-			} while (led-- > 0);
-
-			data_red0 = leds[0][column][RED_LEDS];
-			data_green0 = leds[0][column][GREEN_LEDS];
-			data_blue0 = leds[0][column][BLUE_LEDS];
-			data_red1 = leds[1][column][RED_LEDS];
-			data_green1 = leds[1][column][GREEN_LEDS];
-			data_blue1 = leds[1][column][BLUE_LEDS];
+			data = leds_front[column][OCR0A_cnt];
 
 			// Shift pulse to next column
 			if (OCR0A_cnt == 0) {
@@ -827,50 +2336,38 @@ ISR(TIMER0_COMPA_vect)
 				SET_CLK_HI();
 				SET_CLK_LO();
 			}
-			// Transfer LED level data to Current Drivers
-			do {  
-				// Set Data
-				if(data_red0 & 0x80) SET_HI(R, 0);
-				else SET_LO(R, 0);
 
-				if(data_green0 & 0x80) SET_HI(G, 0);
-				else SET_LO(G, 0);
-	
-				if(data_blue0 & 0x80) SET_HI(B, 0);
-				else SET_LO(B, 0);
+			// Everything but the SDI lines (and SCK) stays as it is
+			port0 = SDI_PORT0 & ~(SDI_MASK0 | SCK);
+			port1 = SDI_PORT1 & ~SDI_MASK1;
 
-				if(data_red1 & 0x80) SET_HI(R, 1);
-				else SET_LO(R, 1);
+			// Transfer LED level data to Current Drivers
+			do {  
+				sdi = *data++;
 
-				if(data_green1 & 0x80) SET_HI(G, 1);
-				else SET_LO(G, 1);
-	
-				if(data_blue1 & 0x80) SET_HI(B, 1);
-				else SET_LO(B, 1);
+				// Set Data, Clock Falling Edge
+				SDI_PORT0 = port0 | (sdi & SDI_MASK0);
+				SDI_PORT1 = port1 | ((sdi >> SDI_SHIFT1) & SDI_MASK1);
 
 				// Clock Rising Edge
-				SET_SCK_HI();
-	
-				// Shift data to next bit
-				data_red0 <<= 1;
-				data_green0 <<= 1;
-				data_blue0 <<= 1;
-				data_red1 <<= 1;
-				data_green1 <<= 1;
-				data_blue1 <<= 1;
-	
-				// Clock Falling Edge
-				SET_SCK_LO();
+				SDI_PORT0 = port0 | (sdi & SDI_MASK0) | SCK;
 			} while (--bit > 0);
 
+			// Clock Falling Edge
+			SET_SCK_LO();
+
 			// Enable new LED data
 			LATCH_LEDS();
 			ENABLE_LEDS();
 			break;
 	}
 	// Restart the count		
-	if (++OCR0A_cnt > MAX_COLOR_RESOLUTION)
+	if (++OCR0A_cnt == PWM_PERIODS)
 		OCR0A_cnt = 0;
+
+#ifdef ISR_STATS
+	RECORD_ISR_TIME(isr_stats.timer0, timer0_sum, timer0_cnt, start);
+#endif
 }
 
 /**************************************************************************
@@ -882,6 +2379,12 @@ static void initialize_AVR(void)
 { 
 	cli();	// Turn off interrupts
 
+#ifdef HW_WATCHDOG
+	// Still running after a watchdog reset, at its shortest time
+	MCUSR &= ~_BV(WDRF);
+	wdt_enable(HW_WDT_TIMEOUT);
+#endif
+
 	// Set up AVR I/O Pins - Mostly all Outputs
 	DDRB = 0xFF;
 	DDRC = (0xFF & ~(_BV(PC0)));
@@ -897,25 +2400,67 @@ static void initialize_AVR(void)
 	PRR = 
 		//_BV(PRTWI) |		// Disable TWI Clock
 		_BV(PRSPI) |		// Disable SPI Clock
-		_BV(PRTIM2) |		// Disable Timer2 Clock
+		//_BV(PRTIM2) |		// Disable Timer2 Clock
+#ifndef ISR_STATS
 		_BV(PRTIM1) |		// Disable Timer1 Clock
+#endif
 		//_BV(PRTIM0) |		// Disable Timer0 Clock
+#if !defined(BENCHMARK) && !defined(UART_LINK)
 		_BV(PRUSART0) |		// Disable USART0 CLock
+#endif
 		_BV(PRADC);			// Disable ADC Clock
 
 	// Timer 0 - LED Control
 	TCCR0A = 
 		_BV(WGM01);			// CTC Mode, TOP = OCR0A
+#if PWM_MODE == PWM_BAM
+	TCCR0B =				
+		_BV(CS00) |			// Prescaler = 64
+		_BV(CS01);			
+	OCR0A = BAM_OCR(0);		// Updated by the ISR for each bit plane
+#else
 	TCCR0B =				
 		_BV(CS00) |			// Prescaler = 1024
 		_BV(CS02);			
 	OCR0A = 2;
+#endif
 	TIMSK0 = _BV(OCIE0A);		// Enable Compare Match A Interrupt
 
+	// Timer 2 - Millisecond tick for the chase sequences
+	TCCR2A =
+		_BV(WGM21);			// CTC Mode, TOP = OCR2A
+	TCCR2B =
+		_BV(CS22);			// Prescaler = 64
+	OCR2A = TICK_OCR;
+	TIMSK2 = _BV(OCIE2A);		// Enable Compare Match A Interrupt
+
+#ifdef ISR_STATS
+	// Timer 1 - Free running CPU cycle counter, no interrupts
+	TCCR1A = 0x00;			// Normal Mode
+	TCCR1B =
+		_BV(CS10);			// Prescaler = 1
+#endif
+
+#ifdef BENCHMARK
+	// USART0 - Benchmark output, 8N1, transmit only
+	UBRR0 = (F_CPU / 8 / BENCH_BAUD) - 1;
+	UCSR0A = _BV(U2X0);
+	UCSR0B = _BV(TXEN0);
+	UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+#endif
+
+#ifdef UART_LINK
+	// USART0 - Messages from the host, 8N1, answers sent back
+	UBRR0 = (F_CPU / 8 / UART_BAUD) - 1;
+	UCSR0A = _BV(U2X0);
+	UCSR0B = _BV(RXCIE0) | _BV(RXEN0) | _BV(TXEN0);
+	UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+#endif
+
 	// TWI - Communication with PubNub Client (bus master)
 	TWAR =	 
-		(TWI_SLAVE_ADDRESS << 1);	// TWI Slave Address
-									// Do Not Recognize General Call
+		(read_address() << 1);		// TWI Slave Address
+									// General Call off until REG_SYNC
 	TWCR = _BV(TWEN);				// Enable TWI
 	sei();	// Turn on interrupts
 }
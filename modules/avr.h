@@ -51,6 +51,7 @@ PORT(LED_PORT) |= LED;	// Set "LED" pin HI
 	Other Macros
 ****************************************************************************/
 #define _NOP() asm volatile("nop")		// Assembly NOP instruction for delay
+#define _MEMORY_BARRIER() asm volatile("" ::: "memory")	// Finish memory writes before going on
 
 #endif // _AVR_H_
 
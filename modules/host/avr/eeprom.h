@@ -0,0 +1,29 @@
+/***************************************************************************
+* 
+* File              : avr/eeprom.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <avr/eeprom.h> in the host build
+*					: EEMEM variables are ordinary variables, holding
+*					: what the .eep file would program
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_AVR_EEPROM_H_
+#define _HOST_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+
+#define eeprom_read_byte(addr)			(*(const volatile uint8_t *)(addr))
+#define eeprom_update_byte(addr, value)	(*(volatile uint8_t *)(addr) = (value))
+#define eeprom_read_block(dst, src, n)	memcpy((dst), (src), (n))
+
+#endif // _HOST_AVR_EEPROM_H_
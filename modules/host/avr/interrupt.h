@@ -0,0 +1,27 @@
+/***************************************************************************
+* 
+* File              : avr/interrupt.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <avr/interrupt.h> in the host build
+*					: ISRs become plain functions, called by the test
+*					: code with host_isr()
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_AVR_INTERRUPT_H_
+#define _HOST_AVR_INTERRUPT_H_
+
+#include "host.h"
+
+#define ISR(vector, ...)	void vector(void); void vector(void)
+
+#define sei()		host_sei()
+#define cli()		host_cli()
+
+#endif // _HOST_AVR_INTERRUPT_H_
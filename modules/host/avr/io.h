@@ -0,0 +1,251 @@
+/***************************************************************************
+* 
+* File              : avr/io.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <avr/io.h> in the host build
+*					: ATmega328p registers only
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_AVR_IO_H_
+#define _HOST_AVR_IO_H_
+
+#include <stdint.h>
+#include "host.h"
+
+/***************************************************************************
+	Register Access - Data Space Addresses, same as the ATmega328p
+****************************************************************************/
+#define _SFR_MEM8(mem)		(*host_reg(mem))
+#define _SFR_MEM16(mem)		(*host_reg16(mem))
+#define _SFR_IO8(io)		_SFR_MEM8((io) + 0x20)
+#define _SFR_IO16(io)		_SFR_MEM16((io) + 0x20)
+
+#ifndef _BV
+#define _BV(bit)			(1 << (bit))
+#endif
+
+/***************************************************************************
+	I/O Ports
+****************************************************************************/
+#define PINB	_SFR_IO8(0x03)
+#define DDRB	_SFR_IO8(0x04)
+#define PORTB	_SFR_IO8(0x05)
+#define PINC	_SFR_IO8(0x06)
+#define DDRC	_SFR_IO8(0x07)
+#define PORTC	_SFR_IO8(0x08)
+#define PIND	_SFR_IO8(0x09)
+#define DDRD	_SFR_IO8(0x0A)
+#define PORTD	_SFR_IO8(0x0B)
+
+#define PB0		0
+#define PB1		1
+#define PB2		2
+#define PB3		3
+#define PB4		4
+#define PB5		5
+#define PB6		6
+#define PB7		7
+
+#define PC0		0
+#define PC1		1
+#define PC2		2
+#define PC3		3
+#define PC4		4
+#define PC5		5
+#define PC6		6
+
+#define PD0		0
+#define PD1		1
+#define PD2		2
+#define PD3		3
+#define PD4		4
+#define PD5		5
+#define PD6		6
+#define PD7		7
+
+/***************************************************************************
+	General Purpose, EEPROM, & System Registers
+****************************************************************************/
+#define GPIOR0	_SFR_IO8(0x1E)
+#define GPIOR1	_SFR_IO8(0x2A)
+#define GPIOR2	_SFR_IO8(0x2B)
+
+#define EECR	_SFR_IO8(0x1F)
+#define EEDR	_SFR_IO8(0x20)
+#define EEARL	_SFR_IO8(0x21)
+#define EEARH	_SFR_IO8(0x22)
+#define EEAR	_SFR_IO16(0x21)
+
+#define EERE	0
+#define EEPE	1
+#define EEMPE	2
+#define EERIE	3
+
+#define MCUSR	_SFR_IO8(0x34)
+#define SREG	_SFR_IO8(0x3F)
+#define WDTCSR	_SFR_MEM8(0x60)
+#define PRR		_SFR_MEM8(0x64)
+
+#define WDRF	3
+
+#define WDP0	0
+#define WDP1	1
+#define WDP2	2
+#define WDE		3
+#define WDCE	4
+#define WDP3	5
+#define WDIE	6
+#define WDIF	7
+
+#define PRADC		0
+#define PRUSART0	1
+#define PRSPI		2
+#define PRTIM1		3
+#define PRTIM0		5
+#define PRTIM2		6
+#define PRTWI		7
+
+/***************************************************************************
+	Pin Change Interrupts (masks are borrowed as globals)
+****************************************************************************/
+#define PCICR	_SFR_MEM8(0x68)
+#define PCMSK0	_SFR_MEM8(0x6B)
+#define PCMSK1	_SFR_MEM8(0x6C)
+#define PCMSK2	_SFR_MEM8(0x6D)
+
+/***************************************************************************
+	Timer/Counter 0
+****************************************************************************/
+#define TIFR0	_SFR_IO8(0x15)
+#define TCCR0A	_SFR_IO8(0x24)
+#define TCCR0B	_SFR_IO8(0x25)
+#define TCNT0	_SFR_IO8(0x26)
+#define OCR0A	_SFR_IO8(0x27)
+#define OCR0B	_SFR_IO8(0x28)
+#define TIMSK0	_SFR_MEM8(0x6E)
+
+#define WGM00	0
+#define WGM01	1
+#define CS00	0
+#define CS01	1
+#define CS02	2
+#define WGM02	3
+#define TOIE0	0
+#define OCIE0A	1
+#define OCIE0B	2
+#define TOV0	0
+#define OCF0A	1
+#define OCF0B	2
+
+/***************************************************************************
+	Timer/Counter 1
+****************************************************************************/
+#define TIFR1	_SFR_IO8(0x16)
+#define TIMSK1	_SFR_MEM8(0x6F)
+#define TCCR1A	_SFR_MEM8(0x80)
+#define TCCR1B	_SFR_MEM8(0x81)
+#define TCCR1C	_SFR_MEM8(0x82)
+#define TCNT1	_SFR_MEM16(0x84)
+#define ICR1	_SFR_MEM16(0x86)
+#define OCR1A	_SFR_MEM16(0x88)
+#define OCR1B	_SFR_MEM16(0x8A)
+
+#define WGM10	0
+#define WGM11	1
+#define CS10	0
+#define CS11	1
+#define CS12	2
+#define WGM12	3
+#define WGM13	4
+#define TOIE1	0
+#define OCIE1A	1
+#define OCIE1B	2
+#define TOV1	0
+#define OCF1A	1
+#define OCF1B	2
+
+/***************************************************************************
+	Timer/Counter 2
+****************************************************************************/
+#define TIFR2	_SFR_IO8(0x17)
+#define TIMSK2	_SFR_MEM8(0x70)
+#define TCCR2A	_SFR_MEM8(0xB0)
+#define TCCR2B	_SFR_MEM8(0xB1)
+#define TCNT2	_SFR_MEM8(0xB2)
+#define OCR2A	_SFR_MEM8(0xB3)
+#define OCR2B	_SFR_MEM8(0xB4)
+
+#define WGM20	0
+#define WGM21	1
+#define CS20	0
+#define CS21	1
+#define CS22	2
+#define WGM22	3
+#define TOIE2	0
+#define OCIE2A	1
+#define OCIE2B	2
+#define TOV2	0
+#define OCF2A	1
+#define OCF2B	2
+
+/***************************************************************************
+	TWI
+****************************************************************************/
+#define TWBR	_SFR_MEM8(0xB8)
+#define TWSR	_SFR_MEM8(0xB9)
+#define TWAR	_SFR_MEM8(0xBA)
+#define TWDR	_SFR_MEM8(0xBB)
+#define TWCR	_SFR_MEM8(0xBC)
+#define TWAMR	_SFR_MEM8(0xBD)
+
+#define TWIE	0
+#define TWEN	2
+#define TWWC	3
+#define TWSTO	4
+#define TWSTA	5
+#define TWEA	6
+#define TWINT	7
+#define TWGCE	0
+
+/***************************************************************************
+	USART0
+****************************************************************************/
+#define UCSR0A	_SFR_MEM8(0xC0)
+#define UCSR0B	_SFR_MEM8(0xC1)
+#define UCSR0C	_SFR_MEM8(0xC2)
+#define UBRR0L	_SFR_MEM8(0xC4)
+#define UBRR0H	_SFR_MEM8(0xC5)
+#define UBRR0	_SFR_MEM16(0xC4)
+#define UDR0	_SFR_MEM8(0xC6)
+
+#define MPCM0	0
+#define U2X0	1
+#define UPE0	2
+#define DOR0	3
+#define FE0		4
+#define UDRE0	5
+#define TXC0	6
+#define RXC0	7
+
+#define TXB80	0
+#define RXB80	1
+#define UCSZ02	2
+#define TXEN0	3
+#define RXEN0	4
+#define UDRIE0	5
+#define TXCIE0	6
+#define RXCIE0	7
+
+#define UCPOL0	0
+#define UCSZ00	1
+#define UCSZ01	2
+#define USBS0	3
+
+#endif // _HOST_AVR_IO_H_
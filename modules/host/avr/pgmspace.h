@@ -0,0 +1,25 @@
+/***************************************************************************
+* 
+* File              : avr/pgmspace.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <avr/pgmspace.h> in the host build
+*					: PROGMEM data is ordinary constant data
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_AVR_PGMSPACE_H_
+#define _HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(addr)		(*(const uint8_t *)(addr))
+
+#endif // _HOST_AVR_PGMSPACE_H_
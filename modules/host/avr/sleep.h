@@ -0,0 +1,26 @@
+/***************************************************************************
+* 
+* File              : avr/sleep.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <avr/sleep.h> in the host build
+*					: Sleeping with interrupts off ends the program,
+*					: as it ends a simavr run (see host_sleep)
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_AVR_SLEEP_H_
+#define _HOST_AVR_SLEEP_H_
+
+#include "host.h"
+
+#define sleep_enable()		((void)0)
+#define sleep_disable()		((void)0)
+#define sleep_cpu()			host_sleep()
+
+#endif // _HOST_AVR_SLEEP_H_
@@ -0,0 +1,35 @@
+/***************************************************************************
+* 
+* File              : avr/wdt.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <avr/wdt.h> in the host build
+*					: The watchdog never resets the host, only WDTCSR
+*					: shows whether it was turned on
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_AVR_WDT_H_
+#define _HOST_AVR_WDT_H_
+
+#include "avr/io.h"
+
+#define WDTO_15MS	0
+#define WDTO_30MS	1
+#define WDTO_60MS	2
+#define WDTO_120MS	3
+#define WDTO_250MS	4
+#define WDTO_500MS	5
+#define WDTO_1S		6
+#define WDTO_2S		7
+
+#define wdt_enable(timeout)	(WDTCSR = _BV(WDE) | (timeout))
+#define wdt_disable()		(WDTCSR = 0)
+#define wdt_reset()			((void)0)
+
+#endif // _HOST_AVR_WDT_H_
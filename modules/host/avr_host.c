@@ -0,0 +1,186 @@
+/***************************************************************************
+* 
+* File              : avr_host.c
+*
+* Date				: October 17, 2026
+*
+* Description       : Mock AVR register layer for the host build
+*
+*	Every register is a byte of host_io[], at its ATmega328p data space
+*	address. Register accesses go through host_reg(), which reports the
+*	value written by the previous access before handing out the next
+*	one. That way every write, including each half of a read-modify-
+*	write, reaches host_write_hook in the order the firmware made it.
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+
+/**************************************************************************
+	Global Variables
+***************************************************************************/
+#define SREG_ADDR	0x5F
+#define SREG_I		0x80
+
+volatile uint8_t	host_io[HOST_IO_SIZE];
+uint8_t				host_interrupts = 0;
+uint64_t			host_accesses = 0;
+double				host_time_us = 0.0;
+
+void (*host_write_hook)(uint8_t addr, uint8_t value) = NULL;
+void (*host_access_hook)(uint8_t addr) = NULL;
+void (*host_delay_hook)(double us) = NULL;
+
+static uint8_t	last_value[HOST_IO_SIZE];	// Value last reported
+static uint8_t	last_addr = 0;				// Last register handed out
+static uint8_t	last_size = 0;				// ... and its size in bytes
+static uint8_t	in_write_hook = 0;			// Hooks may access registers too,
+static uint8_t	in_access_hook = 0;			// but are never called from themselves
+static uint8_t	in_delay_hook = 0;
+
+/**************************************************************************
+	Register Layer
+***************************************************************************/
+
+/**
+ * Report a register if it changed since it was last reported.
+ */
+static void report(const uint8_t addr)
+{
+	const uint8_t value = host_io[addr];
+	if (value == last_value[addr])
+		return;
+	last_value[addr] = value;
+	if (host_write_hook != NULL && !in_write_hook) {
+		in_write_hook = 1;
+		host_write_hook(addr, value);
+		in_write_hook = 0;
+	}
+}
+
+/**
+ * Report any register change not reported yet.
+ */
+void host_flush(void)
+{
+	uint8_t i = 0;
+	for (i = 0; i < last_size; ++i)
+		report((uint8_t)(last_addr + i));
+	last_size = 0;
+}
+
+/**
+ * Hand out a register to the firmware.
+ */
+static void access(const uint8_t addr, const uint8_t size)
+{
+	host_flush();
+	++host_accesses;
+	if (host_access_hook != NULL && !in_access_hook) {
+		in_access_hook = 1;
+		host_access_hook(addr);
+		in_access_hook = 0;
+		host_flush();
+	}
+	last_addr = addr;
+	last_size = size;
+}
+
+volatile uint8_t *host_reg(const uint8_t addr)
+{
+	access(addr, 1);
+	return &host_io[addr];
+}
+
+volatile host_reg16_t *host_reg16(const uint8_t addr)
+{
+	access(addr, 2);
+	return (volatile host_reg16_t *)&host_io[addr];
+}
+
+void host_sei(void)
+{
+	host_interrupts = 1;
+	host_io[SREG_ADDR] |= SREG_I;
+	last_value[SREG_ADDR] = host_io[SREG_ADDR];
+}
+
+void host_cli(void)
+{
+	host_interrupts = 0;
+	host_io[SREG_ADDR] &= (uint8_t)~SREG_I;
+	last_value[SREG_ADDR] = host_io[SREG_ADDR];
+}
+
+void host_delay_us(const double us)
+{
+	host_flush();
+	host_time_us += us;
+	if (host_delay_hook != NULL && !in_delay_hook) {
+		in_delay_hook = 1;
+		host_delay_hook(us);
+		in_delay_hook = 0;
+	}
+}
+
+/**
+ * Sleep until an interrupt. With interrupts off nothing wakes the
+ * CPU, so the program ends there, as a simavr run does.
+ */
+void host_sleep(void)
+{
+	host_flush();
+	if (!host_interrupts)
+		exit(EXIT_SUCCESS);
+}
+
+/**************************************************************************
+	Test Code Interface
+***************************************************************************/
+
+void host_reset(void)
+{
+	memset((void *)host_io, 0, sizeof(host_io));
+	memset(last_value, 0, sizeof(last_value));
+	last_addr = 0;
+	last_size = 0;
+	in_write_hook = 0;
+	in_access_hook = 0;
+	in_delay_hook = 0;
+	host_interrupts = 0;
+	host_accesses = 0;
+	host_time_us = 0.0;
+	host_write_hook = NULL;
+	host_access_hook = NULL;
+	host_delay_hook = NULL;
+}
+
+void host_isr(void (*vector)(void))
+{
+	const uint8_t interrupts = host_interrupts;
+
+	host_flush();
+	host_cli();
+	vector();
+	host_flush();
+	if (interrupts)
+		host_sei();
+}
+
+uint8_t host_peek(const uint8_t addr)
+{
+	return host_io[addr];
+}
+
+void host_poke(const uint8_t addr, const uint8_t value)
+{
+	host_io[addr] = value;
+	last_value[addr] = value;
+}
@@ -0,0 +1,72 @@
+/***************************************************************************
+* 
+* File              : host.h
+*
+* Date				: October 17, 2026
+*
+* Description       : Mock AVR register layer for the host build
+*					: (make host) - firmware logic runs natively,
+*					: test code drives the ISRs and watches the pins
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#include <stdint.h>
+
+/***************************************************************************
+	Register Layer - used by the stand-in AVR headers
+****************************************************************************/
+#define HOST_IO_SIZE	0x100	// Data space up to the last I/O register
+
+typedef uint16_t __attribute__((may_alias)) host_reg16_t;
+
+volatile uint8_t *host_reg(const uint8_t addr);
+volatile host_reg16_t *host_reg16(const uint8_t addr);
+
+void host_sei(void);
+void host_cli(void);
+void host_delay_us(const double us);
+void host_sleep(void);
+
+/***************************************************************************
+	Test Code Interface
+****************************************************************************/
+// The firmware, built with main renamed
+int firmware_main(void);
+
+// Interrupt vectors implemented by the firmware
+void TIMER0_COMPA_vect(void);
+void TIMER2_COMPA_vect(void);
+void TWI_vect(void);
+void USART_RX_vect(void);
+
+// Clear all registers and the simulated time
+void host_reset(void);
+
+// Run an ISR with interrupts disabled, as the hardware would
+void host_isr(void (*vector)(void));
+
+// Report any register change not reported yet
+void host_flush(void);
+
+// Register access that bypasses the hooks
+uint8_t host_peek(const uint8_t addr);
+void host_poke(const uint8_t addr, const uint8_t value);
+
+extern volatile uint8_t	host_io[HOST_IO_SIZE];
+extern uint8_t			host_interrupts;	// Global interrupt enable
+extern uint64_t			host_accesses;		// Register accesses, ISRs included
+extern double			host_time_us;		// Time spent in delays
+
+// Optional hooks, all NULL after host_reset()
+extern void (*host_write_hook)(uint8_t addr, uint8_t value);	// Every register change, in order
+extern void (*host_access_hook)(uint8_t addr);					// Every register access, e.g. to run ISRs in spin loops
+extern void (*host_delay_hook)(double us);						// Every _delay_ms / _delay_us
+
+#endif // _HOST_H_
@@ -0,0 +1,47 @@
+/***************************************************************************
+* 
+* File              : util/atomic.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <util/atomic.h> in the host build
+*					: ATOMIC_BLOCK saves the interrupt enable as the
+*					: avr-libc one saves SREG, and restores it on the
+*					: way out of the block
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_UTIL_ATOMIC_H_
+#define _HOST_UTIL_ATOMIC_H_
+
+#include <stdint.h>
+#include "host.h"
+
+static inline uint8_t host_atomic_cli(void)
+{
+	host_cli();
+	return 1;
+}
+
+static inline void host_atomic_restore(const uint8_t *interrupts)
+{
+	if (*interrupts)
+		host_sei();
+}
+
+static inline void host_atomic_sei(const uint8_t *interrupts)
+{
+	(void)interrupts;
+	host_sei();
+}
+
+#define ATOMIC_RESTORESTATE	uint8_t host_sreg __attribute__((__cleanup__(host_atomic_restore))) = host_interrupts
+#define ATOMIC_FORCEON		uint8_t host_sreg __attribute__((__cleanup__(host_atomic_sei))) = 0
+
+#define ATOMIC_BLOCK(type)	for (type, host_todo = host_atomic_cli(); host_todo; host_todo = 0)
+
+#endif // _HOST_UTIL_ATOMIC_H_
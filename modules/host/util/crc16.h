@@ -0,0 +1,38 @@
+/***************************************************************************
+* 
+* File              : util/crc16.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <util/crc16.h> in the host build
+*					: Same results as the avr-libc versions
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_UTIL_CRC16_H_
+#define _HOST_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+/**
+ * CRC-8 CCITT (polynomial 0x07), one byte at a time.
+ *
+ * @param	crc		running CRC, 0 to start
+ * @param	data	next byte
+ * @return	the updated CRC
+ */
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+	uint8_t i;
+
+	data ^= crc;
+	for (i = 0; i < 8; ++i)
+		data = (data & 0x80) ? (uint8_t)((data << 1) ^ 0x07) : (uint8_t)(data << 1);
+	return data;
+}
+
+#endif	// _HOST_UTIL_CRC16_H_
@@ -0,0 +1,24 @@
+/***************************************************************************
+* 
+* File              : util/delay.h (host)
+*
+* Date				: October 17, 2026
+*
+* Description       : Stand-in for <util/delay.h> in the host build
+*					: Delays advance the simulated time instead
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _HOST_UTIL_DELAY_H_
+#define _HOST_UTIL_DELAY_H_
+
+#include "host.h"
+
+#define _delay_ms(ms)	host_delay_us((double)(ms) * 1000.0)
+#define _delay_us(us)	host_delay_us((double)(us))
+
+#endif // _HOST_UTIL_DELAY_H_
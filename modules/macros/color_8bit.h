@@ -17,12 +17,22 @@
 #ifndef _COLOR_8BIT_
 #define _COLOR_8BIT_
 
+#include <avr/pgmspace.h>
+
 /***************************************************************************
 	Macros
  ***************************************************************************/
 
-#define COLOR_MAX_RESOLUTION	3		// [0, 255] mapped to [0, 3]
+#ifndef COLOR_DEPTH
+#define COLOR_DEPTH				2		// Bits per R, G, & B level
+#endif
+
+#define COLOR_MAX_RESOLUTION	((1 << COLOR_DEPTH) - 1)	// [0, 255] mapped to [0, 2^depth - 1]
 #define MAX_COLOR_RESOLUTION	COLOR_MAX_RESOLUTION
+
+// COLOR_LEVELS are always given as [0, 3], scaled to the color depth
+#define PALETTE_MAX_RESOLUTION	3
+#define PALETTE_TO_LEVEL(LEVEL)	((LEVEL) * COLOR_MAX_RESOLUTION / PALETTE_MAX_RESOLUTION)
 #define COLOR_MASK				0x3F	// Mask the lower 6 bits
 
 #define RED_LEVEL	0
@@ -82,9 +92,9 @@
 
 
 /***************************************************************************
-	R G & B Levels for each available color
+	R G & B Levels for each available color - in flash, see pgm_read_byte
  ***************************************************************************/
-static const unsigned char COLOR_LEVELS[UNIQUE_COLORS][RGB_LEVELS] = {
+static const unsigned char COLOR_LEVELS[UNIQUE_COLORS][RGB_LEVELS] PROGMEM = {
 	{0,0,0},	// black (off)
 	//{1,2,1},	
 	//{1,2,2},	
@@ -151,7 +161,7 @@ static const unsigned char COLOR_LEVELS[UNIQUE_COLORS][RGB_LEVELS] = {
 	{1,1,1}		// light grey
 };
 
-static const unsigned char TEST_LEVELS[16][RGB_LEVELS] = {
+static const unsigned char TEST_LEVELS[16][RGB_LEVELS] PROGMEM = {
 	{0,0,0},	// black
 	{3,0,3},	// magenta
 	{1,0,2},	// purple
@@ -170,6 +180,31 @@ static const unsigned char TEST_LEVELS[16][RGB_LEVELS] = {
 	{3,3,3},	// white
 };
 
+#ifdef DITHER_RGB
+/***************************************************************************
+	Gamma 2.2 of each 8 bit level - in flash, see pgm_read_byte
+	LED duty cycles look brighter than they are at the low end.
+ ***************************************************************************/
+static const unsigned char GAMMA_LEVELS[256] PROGMEM = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2,
+	3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6,
+	6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+	12, 13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19,
+	20, 20, 21, 22, 22, 23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29,
+	30, 30, 31, 32, 33, 33, 34, 35, 35, 36, 37, 38, 39, 39, 40, 41,
+	42, 43, 43, 44, 45, 46, 47, 48, 49, 49, 50, 51, 52, 53, 54, 55,
+	56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+	73, 74, 75, 76, 77, 78, 79, 81, 82, 83, 84, 85, 87, 88, 89, 90,
+	91, 93, 94, 95, 97, 98, 99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+	113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+	137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+	163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+	192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+	223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255
+};
+#endif	// DITHER_RGB
+
 #endif	// _COLOR_8BIT_
 
 
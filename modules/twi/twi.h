@@ -22,7 +22,9 @@
 /****************************************************************************
   TWI Status/Control register definitions
 ****************************************************************************/
+#ifndef TWI_BUFFER_SIZE
 #define TWI_BUFFER_SIZE 4
+#endif
 
 /****************************************************************************
   Global definitions
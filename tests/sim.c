@@ -0,0 +1,888 @@
+/***************************************************************************
+*
+* File              : sim.c
+*
+* Date				: October 17, 2026
+*
+* Description       : Board simulation for the host tests (make test)
+*
+*	The firmware runs on its own stack (ucontext), so a test reads
+*	top to bottom: queue some bus traffic, sim_run() for a while,
+*	look at the LEDs. Everything else happens in the access hook,
+*	at every register access of the main loop:
+*
+*	- time moves on by SIM_ACCESS_CYCLES per access, ISRs included
+*	- Timer0, Timer2, the TWI and USART masters raise their
+*	  interrupts, which run in priority order while SREG I is set
+*	- the LED driver pins are decoded from the write hook
+*
+*	Pins decoded (see definitions.h):
+*	- PB0-2, PC1-3:	SDI of matrix 0 and 1, shifted on SCK (PB5)
+*	- PB4:			LATCH, shift registers to the outputs
+*	- PB3:			OE, active LO
+*	- PD4, PD5:		CLK and data of the column register
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "sim.h"
+
+/**************************************************************************
+	Registers and Pins - ATmega328p data space
+***************************************************************************/
+#define PORTB_ADDR		0x25
+#define PORTC_ADDR		0x28
+#define PORTD_ADDR		0x2B
+#define TCCR0B_ADDR		0x45
+#define TCNT0_ADDR		0x46
+#define OCR0A_ADDR		0x47
+#define TIMSK0_ADDR		0x6E
+#define TIMSK2_ADDR		0x70
+#define TCCR2B_ADDR		0xB1
+#define OCR2A_ADDR		0xB3
+#define TWSR_ADDR		0xB9
+#define TWDR_ADDR		0xBB
+#define TWCR_ADDR		0xBC
+#define UCSR0A_ADDR		0xC0
+#define UCSR0B_ADDR		0xC1
+#define UBRR0L_ADDR		0xC4
+#define UBRR0H_ADDR		0xC5
+#define UDR0_ADDR		0xC6
+
+#define CS_MASK			0x07
+
+#define TWI_SRX_ADR_ACK			0x60
+#define TWI_SRX_ADR_DATA_ACK	0x80
+#define TWI_SRX_ADR_DATA_NACK	0x88
+#define TWI_SRX_STOP_RESTART	0xA0
+
+// SDI pins of each matrix, on SDI_PORT0 (PORTB) and SDI_PORT1 (PORTC)
+static const uint8_t SDI_PINS[SIM_MATRICES][SIM_COLORS] = {
+	{SDI_R0, SDI_G0, SDI_B0},
+	{SDI_R1, SDI_G1, SDI_B1},
+};
+
+#define TWI_BIT			(F_CPU / SIM_TWI_HZ)
+#define UART_FIFO		3		// UDR0 is two deep, plus the shift register
+#define FIRMWARE_STACK	(1 << 20)
+
+// Only built with UART_LINK
+void USART_RX_vect(void) __attribute__((weak));
+
+/**************************************************************************
+	Global Variables
+***************************************************************************/
+uint64_t	sim_cycles = 0;
+void		(*sim_step_hook)(void) = NULL;
+uint32_t	sim_main_stall = 0;
+
+uint32_t	sim_refreshes = 0;
+uint32_t	sim_images = 0;
+uint64_t	sim_image_at = 0;
+
+uint32_t	sim_twi_bytes = 0;
+uint32_t	sim_twi_nacks = 0;
+
+uint32_t	sim_uart_overruns = 0;
+
+static uint32_t		checks = 0;
+static uint32_t		failures = 0;
+
+static ucontext_t	test_context;
+static ucontext_t	firmware_context;
+static char			*firmware_stack = NULL;
+static uint64_t		run_until = 0;
+static uint64_t		last_accesses = 0;
+static uint64_t		hold_until = 0;		// No ISR runs before, see sim_hold_interrupts
+
+// Compare match interrupt of a CTC timer
+typedef struct {
+	uint64_t	next;		// Next match, 0: stopped or ISR not run yet
+	uint64_t	match;		// Match of the pending interrupt, the count restarts there
+	uint32_t	wrap;		// Added to the next period, TOP was set below the count
+	bool		pending;
+} sim_timer_t;
+
+static sim_timer_t	timer0;
+static sim_timer_t	timer2;
+
+// TWI master, one message at a time
+enum { TWI_IDLE, TWI_ADDRESS, TWI_DATA, TWI_BYTE, TWI_STOP, TWI_END };
+
+static struct {
+	uint8_t		msg[SIM_TWI_MESSAGES][SIM_TWI_MSG_SIZE];
+	uint8_t		len[SIM_TWI_MESSAGES];
+	uint8_t		head;
+	uint8_t		tail;
+	uint8_t		sent;		// Bytes of the message ACKed
+	uint8_t		state;
+	uint64_t	at;			// Bus event due, SCL held while pending
+	bool		pending;	// TWINT, until the ISR has run
+	bool		nacked;		// Message cut short
+} twi;
+
+// USART, from the host (rx) and to it (tx)
+static struct {
+	uint32_t	baud;
+	uint8_t		line[SIM_UART_BUFFER];		// Waiting to be sent
+	uint16_t	line_head;
+	uint16_t	line_tail;
+	uint64_t	next;						// Stop bit of the byte on the line
+	uint8_t		fifo[UART_FIFO];
+	bool		fifo_fe[UART_FIFO];
+	uint8_t		fifo_len;
+	bool		dor;						// Reported with the next byte read
+	uint8_t		tx[SIM_UART_BUFFER];		// Sent by the firmware
+	uint64_t	tx_at[SIM_UART_BUFFER];
+	uint16_t	tx_head;
+	uint16_t	tx_tail;
+	bool		udr_access;					// Main loop wrote UDR0
+} uart;
+
+// LED drivers
+static struct {
+	uint8_t		portb;
+	uint8_t		portc;
+	uint8_t		portd;
+	uint8_t		shift[SIM_MATRICES][SIM_COLORS];	// Bit N: row N
+	uint8_t		latch[SIM_MATRICES][SIM_COLORS];
+	uint8_t		columns;							// Bit N: column N
+	uint64_t	since;								// On time counted up to
+	bool		refreshing;
+	uint64_t	refresh_at;							// Start of this refresh
+	uint64_t	on[SIM_MATRICES][SIM_COLUMNS][SIM_ROWS][SIM_COLORS];
+	uint8_t		level[SIM_MATRICES][SIM_COLUMNS][SIM_ROWS][SIM_COLORS];
+	uint64_t	average_at;
+	uint64_t	average[SIM_MATRICES][SIM_COLUMNS][SIM_ROWS][SIM_COLORS];
+} leds;
+
+/**************************************************************************
+	Clock and Timers
+***************************************************************************/
+
+/**
+ * Charge the register accesses made since the last call.
+ */
+static void advance(void)
+{
+	sim_cycles += (host_accesses - last_accesses) * SIM_ACCESS_CYCLES;
+	last_accesses = host_accesses;
+}
+
+static uint16_t timer0_prescaler(void)
+{
+	static const uint16_t PRESCALER[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+	return PRESCALER[host_peek(TCCR0B_ADDR) & CS_MASK];
+}
+
+static uint32_t timer0_period(void)
+{
+	return timer0_prescaler() * (host_peek(OCR0A_ADDR) + 1UL);
+}
+
+/**
+ * TCNT0 now, counted from the last match.
+ */
+static uint8_t timer0_count(void)
+{
+	const uint16_t prescaler = timer0_prescaler();
+	return prescaler ? (uint8_t)((sim_cycles - timer0.match) / prescaler) : 0;
+}
+
+/**
+ * The firmware wrote OCR0A or TCNT0. A TOP set below the count is only
+ * matched after the count wraps at 255, and a count written restarts
+ * the period from it.
+ */
+static void write_timer0(const uint8_t addr, const uint8_t value)
+{
+	const uint16_t prescaler = timer0_prescaler();
+
+	if (prescaler == 0)
+		return;
+	if (addr == TCNT0_ADDR) {
+		timer0.match = sim_cycles - (uint64_t)value * prescaler;
+		timer0.wrap = 0;
+		if (!timer0.pending && timer0.next != 0)
+			timer0.next = timer0.match + timer0_period();
+	}
+	else if (timer0.pending && (sim_cycles - timer0.match) / prescaler > value) {
+		timer0.wrap = 256UL * prescaler;
+	}
+}
+
+static uint32_t timer2_period(void)
+{
+	static const uint16_t PRESCALER[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+	return PRESCALER[host_peek(TCCR2B_ADDR) & CS_MASK] * (host_peek(OCR2A_ADDR) + 1UL);
+}
+
+/**
+ * Raise the interrupt of a timer at its compare match. Matches while
+ * it is pending set the same flag again, the latest one counts.
+ */
+static void update_timer(sim_timer_t *timer, const uint32_t period)
+{
+	if (period == 0) {
+		timer->next = 0;
+		return;
+	}
+	if (timer->next == 0 && !timer->pending) {
+		timer->next = sim_cycles + period;
+		timer->match = sim_cycles;
+	}
+	if (timer->next == 0 || sim_cycles < timer->next)
+		return;
+
+	timer->match = timer->next;
+	while (timer->match + period <= sim_cycles)
+		timer->match += period;
+	timer->next = 0;
+	timer->pending = true;
+}
+
+/**
+ * The ISR has run, count the next period from its match
+ * (PWM_BAM sets OCR0A for it in the ISR).
+ */
+static void end_timer(sim_timer_t *timer, const uint32_t period)
+{
+	timer->pending = false;
+	timer->next = period ? timer->match + period + timer->wrap : 0;
+	timer->wrap = 0;
+}
+
+/**************************************************************************
+	TWI Bus Master
+***************************************************************************/
+
+void sim_twi_write(const uint8_t *data, const uint8_t len)
+{
+	const uint8_t next = (twi.tail + 1) % SIM_TWI_MESSAGES;
+
+	if (next == twi.head || len == 0 || len > SIM_TWI_MSG_SIZE) {
+		fprintf(stderr, "sim_twi_write: %u bytes don't fit\n", len);
+		exit(EXIT_FAILURE);
+	}
+	memcpy(twi.msg[twi.tail], data, len);
+	twi.len[twi.tail] = len;
+	twi.tail = next;
+}
+
+bool sim_twi_idle(void)
+{
+	return twi.head == twi.tail && twi.state == TWI_IDLE;
+}
+
+/**
+ * Hand the slave a bus event, SCL is held until its ISR has run.
+ */
+static void twi_raise(const uint8_t status)
+{
+	host_poke(TWSR_ADDR, status);
+	twi.pending = true;
+}
+
+/**
+ * Keep what the slave has not ACKed for the next try. Register
+ * messages go on from the first register not written, anything
+ * else is sent again from the top.
+ */
+static void twi_retry(void)
+{
+	uint8_t *msg = twi.msg[twi.head];
+	uint8_t *len = &twi.len[twi.head];
+
+	++sim_twi_nacks;
+	if (twi.sent >= 2 && msg[0] < REG_FRAME) {
+		msg[twi.sent - 1] = msg[0] + (twi.sent - 1);
+		memmove(msg, &msg[twi.sent - 1], *len - (twi.sent - 1));
+		*len -= twi.sent - 1;
+	}
+}
+
+static void update_twi(void)
+{
+	const uint8_t twcr = host_peek(TWCR_ADDR);
+	const uint8_t *msg = twi.msg[twi.head];
+
+	if (twi.pending || sim_cycles < twi.at)
+		return;
+
+	switch (twi.state) {
+		case TWI_IDLE:
+			if (twi.head == twi.tail)
+				break;
+			// START, SLA+W and its ACK
+			++sim_twi_bytes;
+			twi.sent = 0;
+			twi.nacked = false;
+			twi.at = sim_cycles + 10 * TWI_BIT;
+			twi.state = TWI_ADDRESS;
+			break;
+
+		case TWI_ADDRESS:
+			if ((twcr & (_BV(TWEN) | _BV(TWEA))) != (_BV(TWEN) | _BV(TWEA))) {
+				// Address NACKed, STOP and try again later
+				twi_retry();
+				twi.at = sim_cycles + SIM_TWI_RETRY;
+				twi.state = TWI_IDLE;
+				break;
+			}
+			twi.state = TWI_DATA;
+			twi_raise(TWI_SRX_ADR_ACK);
+			break;
+
+		case TWI_DATA:
+			// The slave is done with the last event
+			if (twi.sent < twi.len[twi.head]) {
+				++sim_twi_bytes;
+				twi.at = sim_cycles + 9 * TWI_BIT;
+				twi.state = TWI_BYTE;
+			}
+			else {
+				twi.at = sim_cycles + TWI_BIT;
+				twi.state = TWI_STOP;
+			}
+			break;
+
+		case TWI_BYTE:
+			host_poke(TWDR_ADDR, msg[twi.sent]);
+			if (twcr & _BV(TWEA)) {
+				++twi.sent;
+				twi.state = TWI_DATA;
+				twi_raise(TWI_SRX_ADR_DATA_ACK);
+			}
+			else {
+				// NACKed, the master sends STOP after this one
+				twi.nacked = true;
+				twi.state = TWI_END;
+				twi_raise(TWI_SRX_ADR_DATA_NACK);
+			}
+			break;
+
+		case TWI_STOP:
+			twi.state = TWI_END;
+			twi_raise(TWI_SRX_STOP_RESTART);
+			break;
+
+		case TWI_END:
+		default:
+			if (twi.nacked) {
+				twi_retry();
+				twi.at = sim_cycles + SIM_TWI_RETRY;
+			}
+			else {
+				twi.head = (twi.head + 1) % SIM_TWI_MESSAGES;
+				twi.at = sim_cycles + TWI_BIT;	// Bus free time
+			}
+			twi.state = TWI_IDLE;
+			break;
+	}
+}
+
+/**************************************************************************
+	USART
+***************************************************************************/
+
+void sim_uart_baud(const uint32_t baud)
+{
+	uart.baud = baud;
+}
+
+void sim_uart_write(const uint8_t *data, const uint16_t len)
+{
+	uint16_t i = 0;
+
+	for (i = 0; i < len; ++i) {
+		const uint16_t next = (uart.line_tail + 1) % SIM_UART_BUFFER;
+		if (next == uart.line_head) {
+			fprintf(stderr, "sim_uart_write: %u bytes don't fit\n", len);
+			exit(EXIT_FAILURE);
+		}
+		uart.line[uart.line_tail] = data[i];
+		uart.line_tail = next;
+	}
+}
+
+bool sim_uart_idle(void)
+{
+	return uart.line_head == uart.line_tail && uart.next == 0;
+}
+
+int sim_uart_read(void)
+{
+	int data = 0;
+
+	if (uart.tx_head == uart.tx_tail || uart.tx_at[uart.tx_head] > sim_cycles)
+		return -1;
+	data = uart.tx[uart.tx_head];
+	uart.tx_head = (uart.tx_head + 1) % SIM_UART_BUFFER;
+	return data;
+}
+
+/**
+ * Bit rate the firmware has set up.
+ */
+static uint32_t uart_firmware_baud(void)
+{
+	const uint16_t ubrr = host_peek(UBRR0L_ADDR) | (host_peek(UBRR0H_ADDR) << 8);
+	return F_CPU / ((host_peek(UCSR0A_ADDR) & _BV(U2X0)) ? 8 : 16) / (ubrr + 1UL);
+}
+
+static uint64_t uart_byte_time(const uint32_t baud)
+{
+	return 10 * (uint64_t)F_CPU / baud;	// Start, 8 data, stop
+}
+
+static void update_uart(void)
+{
+	const uint32_t baud = uart_firmware_baud();
+	const bool framing = (baud > uart.baud ? baud - uart.baud : uart.baud - baud) * 50 > uart.baud;
+	uint8_t data = 0;
+
+	// Ready to send, always
+	host_poke(UCSR0A_ADDR, host_peek(UCSR0A_ADDR) | _BV(UDRE0));
+
+	while (uart.next != 0 && sim_cycles >= uart.next) {
+		data = uart.line[uart.line_head];
+		uart.line_head = (uart.line_head + 1) % SIM_UART_BUFFER;
+
+		if (!(host_peek(UCSR0B_ADDR) & _BV(RXEN0))) {
+			// Receiver off, nothing to see
+		}
+		else if (uart.fifo_len < UART_FIFO) {
+			uart.fifo[uart.fifo_len] = data;
+			uart.fifo_fe[uart.fifo_len] = framing;
+			++uart.fifo_len;
+		}
+		else {
+			++sim_uart_overruns;
+			uart.dor = true;
+		}
+
+		if (uart.line_head != uart.line_tail)
+			uart.next += uart_byte_time(uart.baud);
+		else
+			uart.next = 0;
+	}
+	if (uart.next == 0 && uart.line_head != uart.line_tail && uart.baud != 0)
+		uart.next = sim_cycles + uart_byte_time(uart.baud);
+}
+
+/**
+ * Put the oldest byte received in UDR0, for the ISR.
+ */
+static void uart_receive(void)
+{
+	uint8_t status = (host_peek(UCSR0A_ADDR) & _BV(U2X0)) | _BV(UDRE0) | _BV(RXC0);
+
+	if (uart.fifo_fe[0])
+		status |= _BV(FE0);
+	if (uart.dor)
+		status |= _BV(DOR0);
+	uart.dor = false;
+
+	host_poke(UCSR0A_ADDR, status);
+	host_poke(UDR0_ADDR, uart.fifo[0]);
+	--uart.fifo_len;
+	memmove(uart.fifo, &uart.fifo[1], uart.fifo_len);
+	memmove(uart.fifo_fe, &uart.fifo_fe[1], uart.fifo_len);
+}
+
+/**
+ * Take the byte the main loop wrote to UDR0, on the line until its
+ * stop bit.
+ */
+static void uart_transmit(void)
+{
+	const uint16_t next = (uart.tx_tail + 1) % SIM_UART_BUFFER;
+	const uint64_t at = (uart.tx_head != uart.tx_tail) ?
+						uart.tx_at[(uart.tx_tail + SIM_UART_BUFFER - 1) % SIM_UART_BUFFER] : 0;
+
+	if (next == uart.tx_head)
+		return;
+	uart.tx[uart.tx_tail] = host_peek(UDR0_ADDR);
+	uart.tx_at[uart.tx_tail] = (at > sim_cycles ? at : sim_cycles) + uart_byte_time(uart_firmware_baud());
+	uart.tx_tail = next;
+}
+
+/**************************************************************************
+	LED Drivers
+***************************************************************************/
+
+/**
+ * Level of a duty cycle, PWM_LINEAR with 2 bit colors. The last
+ * plane is held for two periods, so levels are 0, 1/4, 2/4 and 4/4.
+ */
+static uint8_t duty_level(const double duty)
+{
+	if (duty < 0.125)
+		return 0;
+	if (duty < 0.375)
+		return 1;
+	if (duty < 0.75)
+		return 2;
+	return 3;
+}
+
+/**
+ * Count the on time of the lit LEDs up to now.
+ */
+static void count_on_time(void)
+{
+	const uint64_t time = sim_cycles - leds.since;
+	uint8_t mtrx = 0, col = 0, row = 0, color = 0;
+
+	leds.since = sim_cycles;
+	if ((leds.portb & LED_OE) || leds.columns == 0 || (leds.columns & (leds.columns - 1)))
+		return;
+
+	col = __builtin_ctz(leds.columns);
+	for (mtrx = 0; mtrx < SIM_MATRICES; ++mtrx) {
+		for (color = 0; color < SIM_COLORS; ++color) {
+			for (row = 0; row < SIM_ROWS; ++row) {
+				if (leds.latch[mtrx][color] & (1 << row)) {
+					leds.on[mtrx][col][row][color] += time;
+					leds.average[mtrx][col][row][color] += time;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Column 0 again, turn the on times of the last refresh into levels.
+ */
+static void end_refresh(void)
+{
+	const double column = (sim_cycles - leds.refresh_at) / (double)SIM_COLUMNS;
+	bool changed = false;
+	uint8_t mtrx = 0, col = 0, row = 0, color = 0;
+	uint8_t level = 0;
+
+	if (leds.refreshing) {
+		for (mtrx = 0; mtrx < SIM_MATRICES; ++mtrx) {
+			for (col = 0; col < SIM_COLUMNS; ++col) {
+				for (row = 0; row < SIM_ROWS; ++row) {
+					for (color = 0; color < SIM_COLORS; ++color) {
+						level = duty_level(leds.on[mtrx][col][row][color] / column);
+						changed |= (level != leds.level[mtrx][col][row][color]);
+						leds.level[mtrx][col][row][color] = level;
+					}
+				}
+			}
+		}
+		++sim_refreshes;
+		if (changed) {
+			++sim_images;
+			sim_image_at = leds.refresh_at;
+		}
+	}
+	memset(leds.on, 0, sizeof(leds.on));
+	leds.refresh_at = sim_cycles;
+	leds.refreshing = true;
+}
+
+static void write_portb(const uint8_t value)
+{
+	const uint8_t rising = value & ~leds.portb;
+	uint8_t color = 0;
+
+	count_on_time();
+	if (rising & SCK) {
+		for (color = 0; color < SIM_COLORS; ++color) {
+			leds.shift[0][color] = (leds.shift[0][color] << 1) | ((value & SDI_PINS[0][color]) ? 1 : 0);
+			leds.shift[1][color] = (leds.shift[1][color] << 1) | ((leds.portc & SDI_PINS[1][color]) ? 1 : 0);
+		}
+	}
+	if (rising & LATCH)
+		memcpy(leds.latch, leds.shift, sizeof(leds.latch));
+	leds.portb = value;
+}
+
+static void write_portd(const uint8_t value)
+{
+	const uint8_t rising = value & ~leds.portd;
+
+	count_on_time();
+	if (rising & CLK) {
+		leds.columns = (leds.columns << 1) | ((value & REG_DATA) ? 1 : 0);
+		if (value & REG_DATA)
+			end_refresh();
+	}
+	leds.portd = value;
+}
+
+uint8_t sim_level(const uint8_t mtrx, const uint8_t row, const uint8_t col, const uint8_t color)
+{
+	return leds.level[mtrx][col][row][color];
+}
+
+void sim_average_start(void)
+{
+	count_on_time();
+	memset(leds.average, 0, sizeof(leds.average));
+	leds.average_at = sim_cycles;
+}
+
+double sim_average(const uint8_t mtrx, const uint8_t row, const uint8_t col, const uint8_t color)
+{
+	const double column = (sim_cycles - leds.average_at) / (double)SIM_COLUMNS;
+
+	count_on_time();
+	return column > 0 ? leds.average[mtrx][col][row][color] / column : 0.0;
+}
+
+/**************************************************************************
+	Frames
+***************************************************************************/
+
+void sim_test_frame(const uint8_t n, uint8_t frame[FRAME_PIXELS])
+{
+	uint8_t pixel = 0;
+
+	for (pixel = 0; pixel < FRAME_PIXELS; ++pixel)
+		frame[pixel] = (pixel * 5 + n * 7) & 0x3F;
+}
+
+void sim_read_frame(uint8_t frame[FRAME_PIXELS])
+{
+	uint8_t pixel = 0;
+	uint8_t mtrx = 0, col = 0, row = 0;
+
+	for (pixel = 0; pixel < FRAME_PIXELS; ++pixel) {
+		mtrx = pixel / (SIM_COLUMNS * SIM_ROWS);
+		col = (pixel / SIM_ROWS) % SIM_COLUMNS;
+		row = pixel % SIM_ROWS;
+		frame[pixel] = sim_level(mtrx, row, col, SIM_RED) |
+					   (sim_level(mtrx, row, col, SIM_GREEN) << 2) |
+					   (sim_level(mtrx, row, col, SIM_BLUE) << 4);
+	}
+}
+
+uint16_t sim_wrong_leds(const uint8_t frame[FRAME_PIXELS])
+{
+	uint8_t shown[FRAME_PIXELS];
+	uint8_t pixel = 0;
+	uint8_t color = 0;
+	uint16_t wrong = 0;
+
+	sim_read_frame(shown);
+	for (pixel = 0; pixel < FRAME_PIXELS; ++pixel) {
+		for (color = 0; color < SIM_COLORS; ++color) {
+			if (((shown[pixel] ^ frame[pixel]) >> (2 * color)) & 0x03)
+				++wrong;
+		}
+	}
+	return wrong;
+}
+
+void sim_pack_frame(const uint8_t frame[FRAME_PIXELS], uint8_t msg[FRAME_BYTES + 1])
+{
+	uint8_t pixel = 0;
+	uint32_t bits = 0;
+
+	msg[0] = REG_FRAME;
+	for (pixel = 0; pixel < FRAME_PIXELS; pixel += 4) {
+		bits = frame[pixel] | (frame[pixel + 1] << 6) | (frame[pixel + 2] << 12) |
+			   ((uint32_t)frame[pixel + 3] << 18);
+		msg[1 + pixel / 4 * 3] = bits;
+		msg[2 + pixel / 4 * 3] = bits >> 8;
+		msg[3 + pixel / 4 * 3] = bits >> 16;
+	}
+}
+
+/**************************************************************************
+	Hooks
+***************************************************************************/
+
+/**
+ * Bring the masters and timers up to now.
+ */
+static void update(void)
+{
+	advance();
+	update_timer(&timer0, timer0_period());
+	update_timer(&timer2, timer2_period());
+	host_poke(TCNT0_ADDR, timer0_count());
+	update_twi();
+	update_uart();
+}
+
+/**
+ * Run the pending interrupts, highest priority (lowest vector) first.
+ */
+static void run_interrupts(void)
+{
+	for (;;) {
+		if (!host_interrupts || sim_cycles < hold_until)
+			return;
+
+		if (timer2.pending && (host_peek(TIMSK2_ADDR) & _BV(OCIE2A))) {
+			host_isr(TIMER2_COMPA_vect);
+			end_timer(&timer2, timer2_period());
+		}
+		else if (timer0.pending && (host_peek(TIMSK0_ADDR) & _BV(OCIE0A))) {
+			host_isr(TIMER0_COMPA_vect);
+			end_timer(&timer0, timer0_period());
+		}
+		else if (uart.fifo_len && (host_peek(UCSR0B_ADDR) & _BV(RXCIE0)) && USART_RX_vect != NULL) {
+			uart_receive();
+			host_isr(USART_RX_vect);
+			host_poke(UCSR0A_ADDR, (host_peek(UCSR0A_ADDR) & _BV(U2X0)) | _BV(UDRE0) |
+									(uart.fifo_len ? _BV(RXC0) : 0));
+		}
+		else if (twi.pending && (host_peek(TWCR_ADDR) & _BV(TWIE))) {
+			twi.pending = false;
+			host_isr(TWI_vect);
+		}
+		else {
+			return;
+		}
+		update();
+	}
+}
+
+/**
+ * Hold the main loop for sim_main_stall, the bus and ISRs still run.
+ */
+static void stall_main(void)
+{
+	const uint64_t until = sim_cycles + sim_main_stall;
+
+	while (sim_cycles < until) {
+		sim_cycles += SIM_ACCESS_CYCLES;
+		update();
+		run_interrupts();
+	}
+}
+
+static void on_access(uint8_t addr)
+{
+	if (uart.udr_access)
+		uart_transmit();
+	uart.udr_access = (addr == UDR0_ADDR);
+
+	update();
+	run_interrupts();
+	if (host_interrupts)
+		stall_main();
+	if (sim_step_hook != NULL)
+		sim_step_hook();
+
+	if (sim_cycles >= run_until)
+		swapcontext(&firmware_context, &test_context);
+}
+
+static void on_write(uint8_t addr, uint8_t value)
+{
+	advance();
+	switch (addr) {
+		case PORTB_ADDR:	write_portb(value);		break;
+		case PORTC_ADDR:	leds.portc = value;		break;
+		case PORTD_ADDR:	write_portd(value);		break;
+		case TCNT0_ADDR:
+		case OCR0A_ADDR:	write_timer0(addr, value);	break;
+		default:								break;
+	}
+	// Registers read in an ISR don't reach on_access, keep TCNT0 current
+	host_poke(TCNT0_ADDR, timer0_count());
+}
+
+static void on_delay(double us)
+{
+	advance();
+	sim_cycles += (uint64_t)(us * SIM_US);
+}
+
+/**************************************************************************
+	Simulation
+***************************************************************************/
+
+static void run_firmware(void)
+{
+	firmware_main();
+	fprintf(stderr, "firmware_main() returned\n");
+	exit(EXIT_FAILURE);
+}
+
+void sim_start(void)
+{
+	// The firmware's own variables are only set up once
+	if (firmware_stack != NULL) {
+		fprintf(stderr, "sim_start: only once per test\n");
+		exit(EXIT_FAILURE);
+	}
+
+	host_reset();
+	host_access_hook = on_access;
+	host_write_hook = on_write;
+	host_delay_hook = on_delay;
+
+	sim_cycles = 0;
+	sim_main_stall = 0;
+	last_accesses = host_accesses;
+	uart.baud = 0;
+
+	firmware_stack = malloc(FIRMWARE_STACK);
+	if (firmware_stack == NULL) {
+		fprintf(stderr, "sim_start: no memory\n");
+		exit(EXIT_FAILURE);
+	}
+	getcontext(&firmware_context);
+	firmware_context.uc_stack.ss_sp = firmware_stack;
+	firmware_context.uc_stack.ss_size = FIRMWARE_STACK;
+	firmware_context.uc_link = NULL;
+	makecontext(&firmware_context, run_firmware, 0);
+}
+
+void sim_run(const uint64_t cycles)
+{
+	run_until = sim_cycles + cycles;
+	swapcontext(&test_context, &firmware_context);
+}
+
+void sim_run_ms(const uint32_t ms)
+{
+	sim_run((uint64_t)ms * SIM_MS);
+}
+
+void sim_hold_interrupts(const uint32_t cycles)
+{
+	hold_until = sim_cycles + cycles;
+}
+
+/**************************************************************************
+	Checks
+***************************************************************************/
+
+void sim_check(const bool ok, const char *format, ...)
+{
+	va_list args;
+
+	++checks;
+	if (ok)
+		return;
+	++failures;
+	va_start(args, format);
+	printf("FAIL: ");
+	vprintf(format, args);
+	printf("\n");
+	va_end(args);
+}
+
+int sim_result(const char *test)
+{
+	printf("%s: %s (%u of %u checks failed)\n", test, failures ? "FAIL" : "PASS",
+		   (unsigned)failures, (unsigned)checks);
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/***************************************************************************
+*
+* File              : sim.h
+*
+* Date				: October 17, 2026
+*
+* Description       : Board simulation for the host tests (make test)
+*					: - runs the host build against a clock, both
+*					: timers, a TWI and a USART bus master, and
+*					: decodes the LED driver pins back into pixels
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/io.h>
+#include "host.h"
+
+// The protocol (registers, frames, UART packets) is the firmware's own,
+// for the versions matrixRGB_main-v3.1.c is built as
+#define FW_VERSION			0x31
+#define HW_VERSION			0x20
+#include "definitions.h"
+
+/***************************************************************************
+	Board
+****************************************************************************/
+#define SIM_MATRICES		2
+#define SIM_ROWS			8
+#define SIM_COLUMNS			8
+#define SIM_RED				0
+#define SIM_GREEN			1
+#define SIM_BLUE			2
+#define SIM_COLORS			3
+
+// Time, in CPU cycles. The host build has no instruction timing,
+// so every register access (ISRs included) is charged the same.
+// The refresh ISR is ~45 accesses, ~360 cycles, but the main
+// loop's RAM-only work is free.
+#define SIM_ACCESS_CYCLES	8
+#define SIM_US				(F_CPU / 1000000UL)
+#define SIM_MS				(F_CPU / 1000UL)
+
+#define SIM_TWI_HZ			400000UL			// Bus master clock, fast mode
+#define SIM_TWI_RETRY		(100 * SIM_US)		// Master waits after a NACK
+#define SIM_TWI_MSG_SIZE	128					// Longest message sent
+#define SIM_TWI_MESSAGES	64					// Messages waiting to be sent
+
+#define SIM_UART_BUFFER		1024				// Bytes waiting in each direction
+
+/***************************************************************************
+	Simulation
+****************************************************************************/
+extern uint64_t	sim_cycles;		// CPU cycles since sim_start()
+
+// Optional, called from the firmware's main loop at every register access
+extern void (*sim_step_hook)(void);
+
+// Cycles added to every main loop register access, for a main loop
+// slower than its ISRs (0 after sim_start)
+extern uint32_t	sim_main_stall;
+
+// Reset the board, the firmware starts at the first sim_run()
+void sim_start(void);
+
+// Run the firmware, ISRs included, for a while
+void sim_run(const uint64_t cycles);
+void sim_run_ms(const uint32_t ms);
+
+// Hold off every ISR for cycles from now, as a long ISR would
+void sim_hold_interrupts(const uint32_t cycles);
+
+/***************************************************************************
+	LED Drivers - decoded from the pin writes
+****************************************************************************/
+extern uint32_t	sim_refreshes;		// Complete refreshes (all columns) shown
+extern uint32_t	sim_images;			// ... that differed from the one before
+extern uint64_t	sim_image_at;		// sim_cycles when the last new image started
+
+// Level [0, 3] of an LED in the last complete refresh
+uint8_t sim_level(const uint8_t mtrx, const uint8_t row, const uint8_t col, const uint8_t color);
+
+// Duty [0, 1] of an LED within its column, averaged from sim_average_start()
+void sim_average_start(void);
+double sim_average(const uint8_t mtrx, const uint8_t row, const uint8_t col, const uint8_t color);
+
+/***************************************************************************
+	Frames - direct colors (R | G << 2 | B << 4) of every pixel, in
+	the order of colors[][][] (matrix, column, row)
+****************************************************************************/
+// Test frame N, every one differs from the one before
+void sim_test_frame(const uint8_t n, uint8_t frame[FRAME_PIXELS]);
+
+// The frame of the last complete refresh
+void sim_read_frame(uint8_t frame[FRAME_PIXELS]);
+
+// LEDs of the last complete refresh that are not as in a frame
+uint16_t sim_wrong_leds(const uint8_t frame[FRAME_PIXELS]);
+
+// REG_FRAME message of a frame, 4 pixels packed LSB first in 3 bytes
+void sim_pack_frame(const uint8_t frame[FRAME_PIXELS], uint8_t msg[FRAME_BYTES + 1]);
+
+/***************************************************************************
+	TWI Bus Master - writes only, to the one slave
+****************************************************************************/
+extern uint32_t	sim_twi_bytes;		// Bytes on the bus, SLA+W and NACKed ones included
+extern uint32_t	sim_twi_nacks;		// Messages cut short, then sent again
+
+// Queue a write message, register first. The master sends them in
+// order, as fast as the slave ACKs. After a NACK it waits
+// SIM_TWI_RETRY and sends the rest (of a register message) or all
+// of it (stream and one byte messages) again.
+void sim_twi_write(const uint8_t *data, const uint8_t len);
+bool sim_twi_idle(void);
+
+/***************************************************************************
+	USART - the other end of the line (UART_LINK), 8N1
+****************************************************************************/
+extern uint32_t	sim_uart_overruns;	// Bytes lost, the receive buffer was full
+
+// Bit rate the host sends at, framing errors unless the firmware matches
+void sim_uart_baud(const uint32_t baud);
+
+// Queue bytes to send back to back
+void sim_uart_write(const uint8_t *data, const uint16_t len);
+bool sim_uart_idle(void);
+
+// Next byte the firmware sent, -1 if none has arrived yet
+int sim_uart_read(void);
+
+/***************************************************************************
+	Checks
+****************************************************************************/
+// Count a check that failed, and say why (printf format)
+void sim_check(const bool ok, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Report the checks of a test, its exit code
+int sim_result(const char *test);
+
+#endif // _SIM_H_
@@ -0,0 +1,122 @@
+/***************************************************************************
+*
+* File              : test_bam.c
+*
+* Date				: October 17, 2026
+*
+* Description       : Bit angle modulation (PWM_BAM) read back as the
+*					: duty of each LED, against the 6 bit level of its
+*					: palette color, with Timer0 held up now and then
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+#define LEVEL_MAX		((1 << COLOR_DEPTH) - 1)
+#define SHADES			31			// Palette colors in one message, one per pixel
+
+// Interrupts are held off for HOLD_CYCLES every HOLD_EVERY, at a phase that
+// drifts through the refresh. Longer than bit planes 0 to 2 (BAM_UNIT << 6
+// to << 8 cycles), so their ISR finds TCNT0 past the new OCR0A in some.
+#define HOLD_CYCLES		2000
+#define HOLD_EVERY		(20 * SIM_MS + 97)
+#define MEASURE_MS		2000
+
+// One level. The holds move a little time between bit planes, and the
+// average ends part way through a column, but a plane held until TCNT0
+// wraps at 255 is off by two levels or more.
+#define DUTY_ERROR		(1.0 / LEVEL_MAX)
+
+static uint64_t next_hold = 0;
+
+/**
+ * Hold off the ISRs when the next hold is due (sim_step_hook).
+ */
+static void hold(void)
+{
+	if (sim_cycles < next_hold)
+		return;
+	sim_hold_interrupts(HOLD_CYCLES);
+	next_hold += HOLD_EVERY;
+}
+
+/**
+ * 6 bit level of a color of palette color N - levels up in red, down
+ * in green, and blue on all the time.
+ */
+static uint8_t bam_level(const uint8_t color, const uint8_t rgb)
+{
+	switch (rgb) {
+		case SIM_RED:	return color * 2;
+		case SIM_GREEN:	return LEVEL_MAX - color * 2;
+		default:		return LEVEL_MAX;
+	}
+}
+
+int main(void)
+{
+	uint8_t palette[2 + SHADES * SIM_COLORS];
+	uint8_t runs[1 + SHADES * 2];
+	uint8_t color = 0;
+	uint8_t rgb = 0;
+	double duty = 0;
+	double expect = 0;
+	double error = 0;
+	double worst = 0;
+	double full = 0;
+
+	sim_start();
+	sim_run_ms(20);
+
+	// Palette colors 0 to SHADES - 1, levels [0, 255] as 6 bits << 2
+	palette[0] = REG_PALETTE;
+	palette[1] = 0;
+	for (color = 0; color < SHADES; ++color) {
+		for (rgb = 0; rgb < SIM_COLORS; ++rgb)
+			palette[2 + color * SIM_COLORS + rgb] = bam_level(color, rgb) << 2;
+	}
+	sim_twi_write(palette, sizeof(palette));
+	sim_run_ms(400);
+
+	// Pixel N of matrix 0 in color N
+	runs[0] = REG_RUNS;
+	for (color = 0; color < SHADES; ++color) {
+		runs[1 + color * 2] = 1;
+		runs[2 + color * 2] = color;
+	}
+	sim_twi_write(runs, sizeof(runs));
+	sim_run_ms(50);
+
+	sim_average_start();
+	next_hold = sim_cycles;
+	sim_step_hook = hold;
+	sim_run_ms(MEASURE_MS);
+	sim_step_hook = NULL;
+
+	// Blue is on all the time, but off while its column is loaded, so
+	// duties are of level LEVEL_MAX
+	full = sim_average(0, 0, 0, SIM_BLUE);
+	for (color = 0; color < SHADES; ++color) {
+		for (rgb = 0; rgb < SIM_COLORS; ++rgb) {
+			duty = sim_average(0, color % SIM_ROWS, color / SIM_ROWS, rgb) / full;
+			expect = bam_level(color, rgb) / (double)LEVEL_MAX;
+			error = duty > expect ? duty - expect : expect - duty;
+			if (error > worst)
+				worst = error;
+			if (error > DUTY_ERROR) {
+				sim_check(false, "pixel %u color %u: level %u is %.3f duty, not %.3f", color, rgb,
+						  bam_level(color, rgb), duty, expect);
+			}
+		}
+	}
+	printf("bam: %u levels, duty off by %.4f at most\n", SHADES * SIM_COLORS, worst);
+	sim_check(worst <= DUTY_ERROR, "duty off by %.4f, not %.4f", worst, DUTY_ERROR);
+
+	return sim_result("test_bam");
+}
@@ -0,0 +1,301 @@
+/***************************************************************************
+*
+* File              : test_compress.c
+*
+* Date				: October 17, 2026
+*
+* Description       : Compressed updates over TWI (REG_RUNS, REG_DELTAS)
+*					: - bytes saved on the built-in chase sequences,
+*					: and both decoders, by replaying every change
+*					: of those sequences through them
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+#define SEQUENCE_TIME	3000	// ms of each sequence
+#define MAX_FRAMES		64
+
+typedef struct {
+	const char	*name;
+	uint8_t		chase;
+} sequence_t;
+
+static const sequence_t SEQUENCES[] = {
+	{"LOOP_ALL",		0x01},
+	{"ALL_WHITE",		0x02},
+	{"ALL_COLORS",		0x03},
+	{"BINARY_ROWS",		0x10},
+	{"BINARY_COLS",		0x20},
+	{"QUAD_WHEEL",		0x30},
+	{"QUAD_WHEEL2",		0x31},
+	{"LOOP_QUAD",		0x40},
+	{"SMILEY",			0xE0},
+	{"TEST_CORNERS",	0xF0},
+};
+#define SEQUENCE_COUNT	(sizeof(SEQUENCES) / sizeof(SEQUENCES[0]))
+
+// Frames shown by each sequence, as direct colors (R | G << 2 | B << 4)
+// in the order of colors[][][] (matrix, column, row)
+static uint8_t frames[SEQUENCE_COUNT][MAX_FRAMES][FRAME_PIXELS];
+static uint8_t frame_count[SEQUENCE_COUNT];
+
+/**************************************************************************
+	Frames
+***************************************************************************/
+
+static void write_register(const uint8_t reg, const uint8_t data)
+{
+	const uint8_t msg[] = {reg, data};
+	sim_twi_write(msg, sizeof(msg));
+}
+
+/**
+ * Send a stream message and wait until it is shown.
+ */
+static void write_stream(const uint8_t *msg, const uint8_t len)
+{
+	sim_twi_write(msg, len);
+	while (!sim_twi_idle())
+		sim_run(10 * SIM_US);
+	sim_run_ms(15);		// Two refreshes, the second one whole
+}
+
+static void write_frame(const uint8_t frame[FRAME_PIXELS])
+{
+	uint8_t msg[FRAME_BYTES + 1];
+
+	sim_pack_frame(frame, msg);
+	write_stream(msg, sizeof(msg));
+}
+
+/**************************************************************************
+	Encoders - as a bus master would write them
+***************************************************************************/
+
+/**
+ * Runs that turn one frame into the next, unchanged pixels skipped.
+ *
+ * @param runs	[count, color] pairs, room for FRAME_PIXELS
+ * @return		bytes of runs
+ */
+static uint16_t encode_runs(const uint8_t *from, const uint8_t *to, uint8_t *runs)
+{
+	uint16_t len = 0;
+	uint8_t pixel = 0;
+	uint8_t color = 0;
+	uint8_t count = 0;
+
+	while (pixel < FRAME_PIXELS) {
+		color = (from[pixel] == to[pixel]) ? COLOR_SKIP : to[pixel];
+		for (count = 0; pixel < FRAME_PIXELS; ++count, ++pixel) {
+			if (((from[pixel] == to[pixel]) ? COLOR_SKIP : to[pixel]) != color)
+				break;
+		}
+		runs[len++] = count;
+		runs[len++] = color;
+	}
+	// A skip at the end changes nothing
+	if (len && runs[len - 1] == COLOR_SKIP)
+		len -= 2;
+	return len;
+}
+
+/**
+ * [pixel, color] pairs of the pixels that change.
+ */
+static uint16_t encode_deltas(const uint8_t *from, const uint8_t *to, uint8_t *deltas)
+{
+	uint16_t len = 0;
+	uint8_t pixel = 0;
+
+	for (pixel = 0; pixel < FRAME_PIXELS; ++pixel) {
+		if (from[pixel] != to[pixel]) {
+			deltas[len++] = pixel;
+			deltas[len++] = to[pixel];
+		}
+	}
+	return len;
+}
+
+/**
+ * Send runs in messages of STREAM_BYTES. Every message starts at
+ * pixel 0, so the ones after the first skip to where the last ended.
+ */
+static void write_runs(const uint8_t *runs, const uint16_t len)
+{
+	uint8_t msg[STREAM_BYTES + 1];
+	uint8_t msg_len = 0;
+	uint16_t pixel = 0;
+	uint16_t i = 0;
+
+	msg[0] = REG_RUNS;
+	while (i < len) {
+		msg_len = 1;
+		if (pixel > 0) {
+			msg[msg_len++] = pixel;
+			msg[msg_len++] = COLOR_SKIP;
+		}
+		for (; i < len && msg_len + 2 <= sizeof(msg); i += 2) {
+			msg[msg_len++] = runs[i];
+			msg[msg_len++] = runs[i + 1];
+			pixel += runs[i];
+		}
+		write_stream(msg, msg_len);
+	}
+}
+
+static void write_deltas(const uint8_t *deltas, const uint16_t len)
+{
+	uint8_t msg[STREAM_BYTES + 1];
+	uint16_t i = 0;
+	uint8_t n = 0;
+
+	msg[0] = REG_DELTAS;
+	for (i = 0; i < len; i += n) {
+		n = (len - i < STREAM_BYTES) ? len - i : STREAM_BYTES;
+		memcpy(&msg[1], &deltas[i], n);
+		write_stream(msg, n + 1);
+	}
+}
+
+/**************************************************************************
+	Tests
+***************************************************************************/
+
+/**
+ * Record the frames of every sequence, as shown on the LEDs.
+ */
+static void record_sequences(void)
+{
+	uint8_t seq = 0;
+	uint32_t images = 0;
+	uint64_t end = 0;
+
+	for (seq = 0; seq < SEQUENCE_COUNT; ++seq) {
+		write_register(REG_CHASE, SEQUENCES[seq].chase);
+		images = sim_images;
+		end = sim_cycles + SEQUENCE_TIME * SIM_MS;
+		while (sim_cycles < end && frame_count[seq] < MAX_FRAMES) {
+			sim_run_ms(1);
+			if (sim_images != images) {
+				images = sim_images;
+				sim_read_frame(frames[seq][frame_count[seq]++]);
+			}
+		}
+	}
+}
+
+/**
+ * Bytes of each encoding for every change, against a whole frame.
+ * Data bytes only, SLA+W and the register are the same for all.
+ */
+static void report_sizes(void)
+{
+	uint8_t buf[2 * FRAME_PIXELS];
+	uint32_t total[4] = {0, 0, 0, 0};
+	uint32_t size[4];
+	uint8_t seq = 0;
+	uint8_t i = 0;
+	uint8_t n = 0;
+
+	printf("compress: %-14s %6s %6s %6s %6s %6s\n", "sequence", "frames", "full", "runs", "deltas", "best");
+	for (seq = 0; seq < SEQUENCE_COUNT; ++seq) {
+		memset(size, 0, sizeof(size));
+		for (i = 1; i < frame_count[seq]; ++i) {
+			const uint16_t runs = encode_runs(frames[seq][i - 1], frames[seq][i], buf);
+			const uint16_t deltas = encode_deltas(frames[seq][i - 1], frames[seq][i], buf);
+			size[0] += FRAME_BYTES;
+			size[1] += runs;
+			size[2] += deltas;
+			size[3] += (runs < deltas) ? runs : deltas;
+		}
+		printf("compress: %-14s %6u %6u %6u %6u %6u\n", SEQUENCES[seq].name, frame_count[seq] - 1,
+			   size[0], size[1], size[2], size[3]);
+		for (n = 0; n < 4; ++n)
+			total[n] += size[n];
+		sim_check(frame_count[seq] >= 1, "%s: nothing shown", SEQUENCES[seq].name);
+	}
+	printf("compress: %-14s %6s %6u %6u %6u %6u\n", "total", "", total[0], total[1], total[2], total[3]);
+	printf("compress: best of both is %.0f%% of whole frames\n", 100.0 * total[3] / total[0]);
+	sim_check(total[3] < total[0] / 2, "best of both is %u bytes, not under half of %u", total[3], total[0]);
+}
+
+/**
+ * Replay every change of every sequence with each encoding, and check
+ * the LEDs show the frame it leads to.
+ */
+static void replay_sequences(void)
+{
+	uint8_t buf[2 * FRAME_PIXELS];
+	uint8_t shown[FRAME_PIXELS];
+	uint8_t seq = 0;
+	uint8_t i = 0;
+	uint16_t len = 0;
+	uint16_t wrong[2] = {0, 0};
+
+	write_register(REG_FORMAT, FORMAT_DIRECT);
+	for (seq = 0; seq < SEQUENCE_COUNT; ++seq) {
+		write_frame(frames[seq][0]);
+		for (i = 1; i < frame_count[seq]; ++i) {
+			len = encode_runs(frames[seq][i - 1], frames[seq][i], buf);
+			write_runs(buf, len);
+			sim_read_frame(shown);
+			wrong[0] += memcmp(shown, frames[seq][i], FRAME_PIXELS) != 0;
+		}
+		write_frame(frames[seq][0]);
+		for (i = 1; i < frame_count[seq]; ++i) {
+			len = encode_deltas(frames[seq][i - 1], frames[seq][i], buf);
+			write_deltas(buf, len);
+			sim_read_frame(shown);
+			wrong[1] += memcmp(shown, frames[seq][i], FRAME_PIXELS) != 0;
+		}
+		sim_check(wrong[0] == 0, "%s: %u frames wrong from runs", SEQUENCES[seq].name, wrong[0]);
+		sim_check(wrong[1] == 0, "%s: %u frames wrong from deltas", SEQUENCES[seq].name, wrong[1]);
+		wrong[0] = wrong[1] = 0;
+	}
+}
+
+/**
+ * Runs past the last pixel are cut short, deltas past it are skipped,
+ * and an odd byte at the end is ignored.
+ */
+static void check_limits(void)
+{
+	static const uint8_t BLACK[FRAME_PIXELS];
+	static const uint8_t RUNS[] = {REG_RUNS, 127, COLOR_SKIP, 200, 0x3F, 5};
+	static const uint8_t DELTAS[] = {REG_DELTAS, 0, 0x03, 128, 0x0C, 255, 0x30, 1};
+	uint8_t expect[FRAME_PIXELS];
+	uint8_t shown[FRAME_PIXELS];
+
+	write_frame(BLACK);
+	write_stream(RUNS, sizeof(RUNS));
+	memset(expect, 0, sizeof(expect));
+	expect[127] = 0x3F;
+	sim_read_frame(shown);
+	sim_check(memcmp(shown, expect, FRAME_PIXELS) == 0, "runs past the last pixel");
+
+	write_stream(DELTAS, sizeof(DELTAS));
+	expect[0] = 0x03;
+	sim_read_frame(shown);
+	sim_check(memcmp(shown, expect, FRAME_PIXELS) == 0, "deltas past the last pixel");
+}
+
+int main(void)
+{
+	sim_start();
+	sim_run_ms(20);
+
+	record_sequences();
+	report_sizes();
+	replay_sequences();
+	check_limits();
+
+	return sim_result("test_compress");
+}
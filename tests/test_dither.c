@@ -0,0 +1,93 @@
+/***************************************************************************
+*
+* File              : test_dither.c
+*
+* Date				: October 17, 2026
+*
+* Description       : 8 bit colors (REG_RGB, DITHER_RGB) read back as
+*					: the duty of each LED over many frames, against
+*					: the gamma corrected level that was sent
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "modules/macros/color_8bit.h"
+
+#define PIXELS			((STREAM_BYTES - 1) / SIM_COLORS)	// In one message
+
+// Dither steps are 1/16 of a level, and levels 1/4 of the duty apart (1/2
+// at the top), so rounding is off by 1/64 at most. The rest is the average
+// not being over a whole number of dither cycles.
+#define DUTY_ERROR		0.025
+
+/**
+ * 8 bit level of a color of pixel N - every level from 0 to 255 across
+ * the pixels in red, the other way in green, and a fixed blue.
+ */
+static uint8_t rgb_level(const uint8_t pixel, const uint8_t color)
+{
+	switch (color) {
+		case SIM_RED:	return pixel * 255 / (PIXELS - 1);
+		case SIM_GREEN:	return 255 - pixel * 255 / (PIXELS - 1);
+		default:		return 0x60;
+	}
+}
+
+int main(void)
+{
+	uint8_t msg[STREAM_BYTES + 1];
+	uint8_t pixel = 0;
+	uint8_t color = 0;
+	double duty = 0;
+	double expect = 0;
+	double error = 0;
+	double worst = 0;
+	double full = 0;
+
+	// Unused here, the firmware shows them
+	(void)COLOR_LEVELS;
+	(void)TEST_LEVELS;
+
+	sim_start();
+	sim_run_ms(20);
+
+	// Pixels 0 to PIXELS - 1, matrix 0 from column 0, row 0
+	msg[0] = REG_RGB;
+	msg[1] = 0;
+	for (pixel = 0; pixel < PIXELS; ++pixel) {
+		for (color = 0; color < SIM_COLORS; ++color)
+			msg[2 + pixel * SIM_COLORS + color] = rgb_level(pixel, color);
+	}
+	sim_twi_write(msg, 2 + PIXELS * SIM_COLORS);
+	sim_run_ms(50);
+
+	sim_average_start();
+	sim_run_ms(2000);
+
+	// An LED on all the time is off while its column is loaded, so
+	// duties are of level 255 (red of the last pixel), not of 1
+	full = sim_average(0, (PIXELS - 1) % SIM_ROWS, (PIXELS - 1) / SIM_ROWS, SIM_RED);
+	for (pixel = 0; pixel < PIXELS; ++pixel) {
+		for (color = 0; color < SIM_COLORS; ++color) {
+			duty = sim_average(0, pixel % SIM_ROWS, pixel / SIM_ROWS, color) / full;
+			expect = pgm_read_byte(&GAMMA_LEVELS[rgb_level(pixel, color)]) / 255.0;
+			error = duty > expect ? duty - expect : expect - duty;
+			if (error > worst)
+				worst = error;
+			if (error > DUTY_ERROR) {
+				sim_check(false, "pixel %u color %u: level %u is %.3f duty, not %.3f", pixel, color,
+						  rgb_level(pixel, color), duty, expect);
+			}
+		}
+	}
+	printf("dither: %u levels, duty off by %.3f at most\n", PIXELS * SIM_COLORS, worst);
+	sim_check(worst <= DUTY_ERROR, "duty off by %.3f, not %.3f", worst, DUTY_ERROR);
+
+	return sim_result("test_dither");
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+*
+* File              : test_frame.c
+*
+* Date				: October 17, 2026
+*
+* Description       : Whole frames over TWI (REG_FRAME), back to back
+*					: at 400 kHz - bytes per frame, frames taken and
+*					: shown per second, and every LED of the last one.
+*					: Then a frame slot saved, overwritten and shown
+*					: again (REG_SLOT), and a mixed frame not saved
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+#define FRAMES			60
+#define SLOT			2
+#define SAVE_MS			400		// 3.4 ms for each of FRAME_BYTES, and a bit
+
+int main(void)
+{
+	static const uint8_t DIRECT[] = {REG_FORMAT, FORMAT_DIRECT};
+	static const uint8_t PALETTE[] = {REG_FORMAT, FORMAT_PALETTE};
+	static const uint8_t SAVE[] = {REG_SLOT, FRAME_SAVE | SLOT};
+	static const uint8_t SHOW[] = {REG_SLOT, SLOT};
+	static const uint8_t DELTA[] = {REG_DELTAS, 0, 1};	// Pixel 0 in palette color 1
+	uint8_t pixels[FRAME_PIXELS];
+	uint8_t last[FRAME_PIXELS];
+	uint8_t msg[FRAME_BYTES + 1];
+	uint8_t frame = 0;
+	uint64_t start = 0;
+	uint64_t taken = 0;
+	uint32_t bytes = 0;
+	uint32_t images = 0;
+	double seconds = 0;
+
+	sim_start();
+	sim_run_ms(20);
+	sim_twi_write(DIRECT, sizeof(DIRECT));
+	sim_run_ms(5);
+
+	// Every frame queued at once, the master sends them as fast as they are ACKed
+	start = sim_cycles;
+	bytes = sim_twi_bytes;
+	images = sim_images;
+	for (frame = 0; frame < FRAMES; ++frame) {
+		sim_test_frame(frame, pixels);
+		sim_pack_frame(pixels, msg);
+		sim_twi_write(msg, sizeof(msg));
+	}
+	while (!sim_twi_idle() && sim_cycles - start < 1000 * SIM_MS)
+		sim_run(10 * SIM_US);
+	taken = sim_cycles - start;
+	memcpy(last, pixels, sizeof(last));
+	sim_run_ms(20);
+
+	bytes = sim_twi_bytes - bytes;
+	images = sim_images - images;
+	seconds = taken / (double)F_CPU;
+	printf("frame: %.1f bytes on the bus, %u NACKs\n", bytes / (double)FRAMES, (unsigned)sim_twi_nacks);
+	printf("frame: %.0f frames taken per second\n", FRAMES / seconds);
+	seconds = (sim_image_at - start) / (double)F_CPU;
+	printf("frame: %u of %u frames shown, %.0f per second\n", (unsigned)images, FRAMES, images / seconds);
+
+	sim_check(sim_twi_idle(), "frames not all taken in 1 s");
+	sim_check(bytes >= FRAMES * (FRAME_BYTES + 2), "%u bytes on the bus, too few", (unsigned)bytes);
+	sim_check(FRAMES / (taken / (double)F_CPU) >= 300, "frames taken at %.0f per second, not 300",
+			  FRAMES / (taken / (double)F_CPU));
+	sim_check(images / seconds >= 30, "frames shown at %.0f per second, not 30", images / seconds);
+	sim_check(sim_wrong_leds(last) == 0, "last frame: %u LEDs wrong", sim_wrong_leds(last));
+
+	// A frame that stops short is dropped
+	sim_test_frame(FRAMES, pixels);
+	sim_pack_frame(pixels, msg);
+	sim_twi_write(msg, FRAME_BYTES / 2);
+	sim_run_ms(20);
+	sim_check(sim_wrong_leds(last) == 0, "short frame: %u LEDs changed", sim_wrong_leds(last));
+
+	// Saved direct pixels are shown as direct pixels again, in either REG_FORMAT
+	sim_twi_write(SAVE, sizeof(SAVE));
+	sim_run_ms(SAVE_MS);
+	sim_twi_write(PALETTE, sizeof(PALETTE));
+	sim_twi_write(msg, sizeof(msg));
+	sim_run_ms(20);
+	sim_check(sim_wrong_leds(last) != 0, "frame after the save not shown");
+	sim_twi_write(SHOW, sizeof(SHOW));
+	sim_run_ms(20);
+	sim_check(sim_wrong_leds(last) == 0, "saved frame: %u LEDs wrong", sim_wrong_leds(last));
+
+	// A frame of direct and palette pixels leaves the slot as it was
+	sim_twi_write(DELTA, sizeof(DELTA));
+	sim_twi_write(SAVE, sizeof(SAVE));
+	sim_run_ms(SAVE_MS);
+	sim_twi_write(msg, sizeof(msg));
+	sim_run_ms(20);
+	sim_twi_write(SHOW, sizeof(SHOW));
+	sim_run_ms(20);
+	sim_check(sim_wrong_leds(last) == 0, "mixed frame saved: %u LEDs wrong", sim_wrong_leds(last));
+
+	return sim_result("test_frame");
+}
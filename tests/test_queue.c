@@ -0,0 +1,140 @@
+/***************************************************************************
+*
+* File              : test_queue.c
+*
+* Date				: October 17, 2026
+*
+* Description       : Every LED drawn with its own register message, as
+*					: fast as the bus goes - no NACKs while the main
+*					: loop is held up for an EEPROM write, and no byte
+*					: that was ACKed lost when it is far slower
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+#define DELTAS			8						// Pixels changed again by the stream
+#define EEPROM_WRITE	(3400 * SIM_US)			// Main loop held once, for a byte
+#define HOLD_AT			32						// ... after this many messages
+#define MAIN_STALL		(2 * SIM_MS)			// Main loop held at every register access
+
+/**
+ * Direct color (2 bits each of R, G, B) drawn at a pixel in a round,
+ * pixels in the order of colors[][][] (matrix, column, row).
+ */
+static uint8_t draw_color(const uint8_t round, const uint8_t pixel)
+{
+	return (pixel * 11 + round * 7 + 3) & 0x3F;
+}
+
+static uint8_t delta_color(const uint8_t pixel)
+{
+	return (pixel * 5 + 1) & 0x3F;
+}
+
+/**
+ * LEDs of the last refresh that are not what was sent in a round.
+ */
+static uint16_t wrong_leds(const uint8_t round, const uint8_t deltas)
+{
+	uint8_t frame[FRAME_PIXELS];
+	uint8_t pixel = 0;
+
+	for (pixel = 0; pixel < FRAME_PIXELS; ++pixel)
+		frame[pixel] = (pixel < deltas) ? delta_color(pixel) : draw_color(round, pixel);
+	return sim_wrong_leds(frame);
+}
+
+/**
+ * The main loop is held once, at its next register access.
+ */
+static void end_hold(void)
+{
+	sim_main_stall = 0;
+	sim_step_hook = NULL;
+}
+
+/**
+ * Draw every LED: [REG_COLOR, color, matrix, row, column, quad, DRAW_LED],
+ * six register writes a message, queued for the master as it takes them.
+ * The main loop is held for EEPROM_WRITE after HOLD_AT messages if asked.
+ */
+static void draw_leds(const uint8_t round, const bool hold)
+{
+	const uint64_t start = sim_cycles;
+	uint8_t msg[7];
+	uint8_t pixel = 0;
+
+	for (pixel = 0; pixel < FRAME_PIXELS; ++pixel) {
+		msg[0] = REG_COLOR;
+		msg[1] = draw_color(round, pixel);
+		msg[2] = pixel / (SIM_COLUMNS * SIM_ROWS);
+		msg[3] = pixel % SIM_ROWS;
+		msg[4] = (pixel / SIM_ROWS) % SIM_COLUMNS;
+		msg[5] = 0;
+		msg[6] = DRAW_LED;
+		sim_twi_write(msg, sizeof(msg));
+		if (hold && pixel == HOLD_AT) {
+			sim_main_stall = EEPROM_WRITE;
+			sim_step_hook = end_hold;
+		}
+		while (pixel % 32 == 31 && !sim_twi_idle() && sim_cycles - start < 5000 * SIM_MS)
+			sim_run(10 * SIM_US);		// Room in the master's queue
+	}
+}
+
+int main(void)
+{
+	static const uint8_t DIRECT[] = {REG_FORMAT, FORMAT_DIRECT};
+	uint8_t msg[2 * DELTAS + 1];
+	uint8_t pixel = 0;
+	uint32_t bytes = 0;
+	uint64_t start = 0;
+
+	sim_start();
+	sim_run_ms(20);
+	sim_twi_write(DIRECT, sizeof(DIRECT));
+	sim_run_ms(5);
+
+	// A burst at the bus rate, the main loop busy for a while in the middle
+	start = sim_cycles;
+	bytes = sim_twi_bytes;
+	draw_leds(0, true);
+	while (!sim_twi_idle() && sim_cycles - start < 1000 * SIM_MS)
+		sim_run(10 * SIM_US);
+	printf("queue: burst of %u bytes in %.1f ms, %u NACKs\n", (unsigned)(sim_twi_bytes - bytes),
+		   (sim_cycles - start) / (double)SIM_MS, (unsigned)sim_twi_nacks);
+	sim_run_ms(20);
+	sim_check(sim_twi_nacks == 0, "%u NACKs in a burst, the master had to slow down", (unsigned)sim_twi_nacks);
+	sim_check(wrong_leds(0, 0) == 0, "burst: %u LEDs wrong", wrong_leds(0, 0));
+
+	// Far more than the main loop keeps up with, then a stream
+	sim_main_stall = MAIN_STALL;
+	start = sim_cycles;
+	bytes = sim_twi_bytes;
+	draw_leds(1, false);
+	msg[0] = REG_DELTAS;
+	for (pixel = 0; pixel < DELTAS; ++pixel) {
+		msg[1 + 2 * pixel] = pixel;
+		msg[2 + 2 * pixel] = delta_color(pixel);
+	}
+	sim_twi_write(msg, sizeof(msg));
+	while (!sim_twi_idle() && sim_cycles - start < 5000 * SIM_MS)
+		sim_run_ms(1);
+	sim_main_stall = 0;
+	sim_run_ms(20);
+
+	printf("queue: overload of %u bytes in %.0f ms, %u NACKs\n", (unsigned)(sim_twi_bytes - bytes),
+		   (sim_cycles - start) / (double)SIM_MS, (unsigned)sim_twi_nacks);
+	sim_check(sim_twi_idle(), "messages not all taken in 5 s");
+	sim_check(sim_twi_nacks > 0, "the command ring never filled");
+	sim_check(wrong_leds(1, DELTAS) == 0, "overload: %u LEDs wrong, ACKed bytes lost", wrong_leds(1, DELTAS));
+
+	return sim_result("test_queue");
+}
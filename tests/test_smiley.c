@@ -0,0 +1,125 @@
+/***************************************************************************
+*
+* File              : test_smiley.c
+*
+* Date				: October 17, 2026
+*
+* Description       : SMILEY, the power up sequence, read back from
+*					: the LED driver pins - both faces, looking away
+*					: and then back after SMILEY_LOOK_TIME
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+/**************************************************************************
+	Expected Images - ANIM_SMILEY in animations.h
+***************************************************************************/
+// Levels of the colors used, COLOR_LEVELS in color_8bit.h
+typedef struct {
+	char	key;
+	uint8_t	level[SIM_COLORS];
+} color_t;
+
+static const color_t KEYS[] = {
+	{'.', {0, 0, 0}},	// COL_BLACK
+	{'o', {1, 1, 0}},	// COL_OLIVE, FACE_COLOR
+	{'w', {3, 3, 3}},	// COL_WHITE
+	{'c', {3, 1, 2}},	// COL_CORAL
+	{'b', {0, 0, 3}},	// COL_BLUE
+	{'g', {0, 2, 0}},	// COL_GREEN
+};
+
+// Row 0 first, column 0 on the left
+static const char *LOOK_AWAY[SIM_MATRICES][SIM_ROWS] = {
+	{	"oooooooo",
+		"oww..wwo",
+		"obw..bwo",
+		"o...o..o",
+		"o..oo..o",
+		"oc....co",
+		"o.cccc.o",
+		"oooooooo"	},
+	{	"oooooooo",
+		"oww..wwo",
+		"owg..wgo",
+		"o..o...o",
+		"o..oo..o",
+		"oc....co",
+		"o.cccc.o",
+		"oooooooo"	},
+};
+
+static const char *LOOK_BACK[SIM_MATRICES][SIM_ROWS] = {
+	{	"oooooooo",
+		"oww..wwo",
+		"owb..wbo",
+		"o...o..o",
+		"o..oo..o",
+		"oc....co",
+		"o.cccc.o",
+		"oooooooo"	},
+	{	"oooooooo",
+		"oww..wwo",
+		"ogw..gwo",
+		"o..o...o",
+		"o..oo..o",
+		"oc....co",
+		"o.cccc.o",
+		"oooooooo"	},
+};
+
+/**
+ * Check every LED of the last refresh against an image.
+ */
+static void check_image(const char *name, const char *image[SIM_MATRICES][SIM_ROWS])
+{
+	uint8_t mtrx = 0, row = 0, col = 0, color = 0;
+	uint8_t i = 0;
+	uint8_t wrong = 0;
+
+	for (mtrx = 0; mtrx < SIM_MATRICES; ++mtrx) {
+		for (row = 0; row < SIM_ROWS; ++row) {
+			for (col = 0; col < SIM_COLUMNS; ++col) {
+				for (i = 0; KEYS[i].key != image[mtrx][row][col]; ++i)
+					;
+				for (color = 0; color < SIM_COLORS; ++color) {
+					if (sim_level(mtrx, row, col, color) != KEYS[i].level[color] && wrong++ < 4) {
+						sim_check(false, "%s: matrix %u row %u col %u color %u is %u, not %u", name,
+								  mtrx, row, col, color, sim_level(mtrx, row, col, color),
+								  KEYS[i].level[color]);
+					}
+				}
+			}
+		}
+	}
+	sim_check(wrong == 0, "%s: %u LEDs wrong", name, wrong);
+}
+
+int main(void)
+{
+	double seconds = 0;
+
+	sim_start();
+
+	// Looking away for SMILEY_LOOK_TIME (200 ms) from power up
+	sim_run_ms(100);
+	check_image("look away", LOOK_AWAY);
+
+	// Then back, for SMILEY_EYE_DELAY
+	sim_run_ms(300);
+	check_image("look back", LOOK_BACK);
+	sim_check(sim_images == 2, "%u images shown, not 2", sim_images);
+
+	seconds = sim_cycles / (double)F_CPU;
+	printf("refresh: %.0f Hz\n", sim_refreshes / seconds);
+	sim_check(sim_refreshes / seconds > 100, "refresh rate %.0f Hz, flickers", sim_refreshes / seconds);
+
+	return sim_result("test_smiley");
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+*
+* File              : test_uart.c
+*
+* Date				: October 17, 2026
+*
+* Description       : Whole frames over the USART link (UART_LINK),
+*					: each sent once the last was answered - frames
+*					: taken and shown per second at UART_BAUD, and
+*					: a NAK for a packet lost to a framing error
+*
+* Compiler			: GCC (native)
+*
+* More Information	: http://www.projectsbykec.com/
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "sim.h"
+
+#define PACKET_BYTES	(UART_MSG_SIZE + 3)	// Sync, length, message, CRC
+
+#define FRAMES			100
+#define ANSWER_TIMEOUT	(10 * SIM_MS)
+#define TRIES			10
+
+static uint32_t	naks = 0;
+static uint32_t	timeouts = 0;
+
+/**
+ * Send a message in one packet: UART_SYNC, length, message, CRC-8
+ * CCITT of the length & message. Returns the answer, -1 if none came.
+ */
+static int send_packet(const uint8_t *msg, const uint8_t len)
+{
+	uint8_t packet[PACKET_BYTES];
+	uint8_t crc = 0;
+	uint8_t i = 0;
+	uint64_t start = 0;
+	int answer = -1;
+
+	packet[0] = UART_SYNC;
+	packet[1] = len;
+	crc = _crc8_ccitt_update(crc, len);
+	for (i = 0; i < len; ++i) {
+		packet[2 + i] = msg[i];
+		crc = _crc8_ccitt_update(crc, msg[i]);
+	}
+	packet[2 + len] = crc;
+	sim_uart_write(packet, len + 3);
+
+	start = sim_cycles;
+	while (answer < 0 && sim_cycles - start < ANSWER_TIMEOUT) {
+		sim_run(2 * SIM_US);
+		answer = sim_uart_read();
+	}
+
+	// The rest of a packet that was NAKed early goes out first
+	while (!sim_uart_idle())
+		sim_run(2 * SIM_US);
+	return answer;
+}
+
+/**
+ * Send a message until it is ACKed, counting the NAKs and timeouts.
+ */
+static bool send_message(const uint8_t *msg, const uint8_t len)
+{
+	uint8_t i = 0;
+	int answer = -1;
+
+	for (i = 0; i < TRIES; ++i) {
+		answer = send_packet(msg, len);
+		if (answer == UART_ACK)
+			return true;
+		if (answer == UART_NAK)
+			++naks;
+		else
+			++timeouts;
+	}
+	return false;
+}
+
+int main(void)
+{
+	static const uint8_t DIRECT[] = {REG_FORMAT, FORMAT_DIRECT};
+	uint8_t pixels[FRAME_PIXELS];
+	uint8_t msg[FRAME_BYTES + 1];
+	uint8_t frame = 0;
+	uint8_t taken = 0;
+	uint64_t start = 0;
+	uint32_t images = 0;
+	double seconds = 0;
+	double rate = 0;
+	double line_rate = UART_BAUD / 10.0 / PACKET_BYTES;
+	int answer = -1;
+
+	sim_start();
+	sim_run_ms(20);
+	sim_uart_baud(UART_BAUD);
+	sim_check(send_message(DIRECT, sizeof(DIRECT)), "REG_FORMAT not ACKed");
+
+	// One frame at a time, as soon as the last one is ACKed
+	start = sim_cycles;
+	images = sim_images;
+	for (frame = 0; frame < FRAMES; ++frame) {
+		sim_test_frame(frame, pixels);
+		sim_pack_frame(pixels, msg);
+		if (send_message(msg, sizeof(msg)))
+			++taken;
+	}
+	rate = taken / ((sim_cycles - start) / (double)F_CPU);
+	sim_run_ms(20);
+
+	images = sim_images - images;
+	printf("uart: %lu baud, %u NAKs, %u timeouts, %u bytes overrun\n", (unsigned long)UART_BAUD,
+		   (unsigned)naks, (unsigned)timeouts, (unsigned)sim_uart_overruns);
+	printf("uart: %.0f frames taken per second, the line takes %.0f\n", rate, line_rate);
+	seconds = (sim_image_at - start) / (double)F_CPU;
+	printf("uart: %u of %u frames shown, %.0f per second\n", (unsigned)images, FRAMES, images / seconds);
+
+	sim_check(timeouts == 0, "%u packets not answered", (unsigned)timeouts);
+	sim_check(taken == FRAMES, "%u of %u frames taken", taken, FRAMES);
+	sim_check(rate >= line_rate / 2, "frames taken at %.0f per second, under half the line rate", rate);
+	sim_check(images / seconds >= 30, "frames shown at %.0f per second, not 30", images / seconds);
+	sim_check(sim_wrong_leds(pixels) == 0, "last frame: %u LEDs wrong", sim_wrong_leds(pixels));
+
+	// A packet sent at the wrong rate is NAKed, not left unanswered
+	sim_uart_baud(UART_BAUD / 10 * 9);
+	sim_test_frame(FRAMES, pixels);
+	sim_pack_frame(pixels, msg);
+	answer = send_packet(msg, sizeof(msg));
+	sim_check(answer == UART_NAK, "framing errors answered with %d, not UART_NAK", answer);
+	sim_uart_baud(UART_BAUD);
+	sim_check(send_packet(msg, sizeof(msg)) == UART_ACK, "packet after a NAK not ACKed");
+	sim_run_ms(20);
+	sim_check(sim_wrong_leds(pixels) == 0, "frame after a NAK: %u LEDs wrong", sim_wrong_leds(pixels));
+
+	return sim_result("test_uart");
+}